@@ -20,6 +20,15 @@ Configuration load(const std::string& config_path)
     return config;
 }
 
+HeadlessConfiguration loadHeadless(const Configuration& config)
+{
+    if (!config.contains("headless"))
+        return HeadlessConfiguration {};
+
+    JSON_GET(HeadlessConfiguration, headless_cfg, config, "headless");
+    return headless_cfg;
+}
+
 RigidCoupleSimConfiguration RigidCoupleSimConfiguration::load(const std::string& config_path)
 {
     std::ifstream f(config_path);
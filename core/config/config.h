@@ -49,10 +49,19 @@ struct CameraConfiguration {
     float move_speed;
 };
 
+struct RenderGraphNodeConfiguration {
+    std::string name;
+    std::string type;
+    // the node's attachment to the graph's attachment
+    std::unordered_map<std::string, std::string> attachments;
+    std::vector<std::string> dependencies;
+};
+
 struct RenderGraphConfiguration {
     std::string name;
     std::string shader_directory;
     json extra_args;
+    std::vector<RenderGraphNodeConfiguration> nodes; // only for the custom graph
 };
 
 struct FieldConfiguration {
@@ -119,6 +128,11 @@ struct RecorderConfiguration {
     bool dump_frame = false;
 };
 
+struct HeadlessConfiguration {
+    bool enable     = false;
+    int total_frame = 1;
+};
+
 struct RigidCoupleSimConfiguration {
     static RigidCoupleSimConfiguration load(const std::string& config_path);
 
@@ -182,11 +196,19 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
     fov,
     move_speed);
 
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+    RenderGraphNodeConfiguration,
+    name,
+    type,
+    attachments,
+    dependencies);
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
     RenderGraphConfiguration,
     name,
     shader_directory,
-    extra_args);
+    extra_args,
+    nodes);
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
     ObjectConfiguration,
@@ -266,6 +288,11 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
     record_from_start,
     dump_frame);
 
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+    HeadlessConfiguration,
+    enable,
+    total_frame);
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
     RigidCoupleSimConfiguration,
     rigid_couple,
@@ -305,3 +332,5 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
     }
 
 Configuration load(const std::string& config_path);
+// "headless" is optional, a missing section means rendering to a window
+HeadlessConfiguration loadHeadless(const Configuration& config);
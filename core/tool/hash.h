@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// FNV-1a, stable between runs unlike std::hash, for the names of files cached on disk
+struct StableHash {
+    uint64_t value = 14695981039346656037ull;
+
+    void add(std::string_view s)
+    {
+        for (unsigned char c : s) {
+            value ^= c;
+            value *= 1099511628211ull;
+        }
+        // separates the strings
+        value ^= s.size();
+        value *= 1099511628211ull;
+    }
+};
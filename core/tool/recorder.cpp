@@ -309,6 +309,8 @@ void Recorder::end_ffmpeg()
 
 void Recorder::end()
 {
+    if (flush)
+        flush();
     end_ffmpeg();
 
     is_recording = false;
@@ -3,6 +3,7 @@
 #include "core/config/config.h"
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <vector>
 
 struct AVFormatContext;
@@ -37,6 +38,8 @@ public:
     void end_ffmpeg();
 
     bool is_recording = false;
+    // appends the frames still being read back, end() calls it before closing the file
+    std::function<void()> flush;
 
 private:
     static void encode_frame(AVFormatContext* fmt_ctx, AVCodecContext* codec_ctx, AVStream* stream, AVFrame* frame, AVPacket* packet);
@@ -0,0 +1,252 @@
+#include "shader_compiler.h"
+#include "core/filesystem/file.h"
+#include "core/tool/hash.h"
+#include "core/tool/logger.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <thread>
+#ifndef DEBUG
+#include <spirv-tools/optimizer.hpp>
+#endif
+
+namespace {
+
+// part of the hash, change it when the compile options change
+#ifdef DEBUG
+constexpr const char* COMPILE_OPTIONS = "vulkan1.2 spv1.5 debug";
+#else
+constexpr const char* COMPILE_OPTIONS = "vulkan1.2 spv1.5 performance";
+#endif
+
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+struct SourceFile {
+    std::string path; // normalized, the name glslang sees
+    std::string text;
+};
+
+std::string readText(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open shader " + path.string());
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+// the file and all the files it includes, in include order
+void readSources(const std::filesystem::path& path, std::vector<SourceFile>& files)
+{
+    std::string name = path.lexically_normal().string();
+    for (const auto& file : files) {
+        if (file.path == name)
+            return;
+    }
+    files.push_back({ name, readText(path) });
+
+    static const std::regex include_regex(R"(^\s*#\s*include\s*"([^"]+)")");
+    std::vector<std::string> includes;
+    std::istringstream lines(files.back().text);
+    std::string line;
+    std::smatch match;
+    while (std::getline(lines, line)) {
+        if (std::regex_search(line, match, include_regex))
+            includes.emplace_back(match[1].str());
+    }
+    for (const auto& include : includes) {
+        readSources(path.parent_path() / include, files);
+    }
+}
+
+std::string applyDefines(const std::string& source, const ShaderDefines& defines, std::string& preamble)
+{
+    std::string result = source;
+    for (const auto& define : defines) {
+        std::regex define_regex("(#define[ \\t]+" + define.first + "[ \\t]+)[^\\r\\n]*");
+        if (std::regex_search(result, define_regex)) {
+            result = std::regex_replace(result, define_regex, "$1" + define.second, std::regex_constants::format_first_only);
+        } else {
+            preamble += "#define " + define.first + " " + define.second + "\n";
+        }
+    }
+    return result;
+}
+
+EShLanguage getStage(const std::filesystem::path& path)
+{
+    auto extension = path.extension().string();
+    if (extension == ".vert")
+        return EShLangVertex;
+    if (extension == ".frag")
+        return EShLangFragment;
+    if (extension == ".comp")
+        return EShLangCompute;
+    if (extension == ".geom")
+        return EShLangGeometry;
+    throw std::runtime_error("unknown shader stage: " + path.string());
+}
+
+// serves the files read for the hash, so they are read once and hashed as compiled
+class SourceIncluder : public glslang::TShader::Includer {
+    const std::vector<SourceFile>& files;
+
+public:
+    explicit SourceIncluder(const std::vector<SourceFile>& files)
+        : files(files)
+    {
+    }
+
+    IncludeResult* includeLocal(const char* header_name, const char* includer_name, size_t depth) override
+    {
+        auto path = (std::filesystem::path(includer_name).parent_path() / header_name).lexically_normal().string();
+        for (const auto& file : files) {
+            if (file.path == path)
+                return new IncludeResult(file.path, file.text.data(), file.text.size(), nullptr);
+        }
+        return nullptr;
+    }
+
+    void releaseInclude(IncludeResult* result) override
+    {
+        delete result;
+    }
+};
+
+std::vector<uint32_t> compile(const std::vector<SourceFile>& files, const std::string& source, const std::string& preamble)
+{
+    static std::once_flag initialized;
+    std::call_once(initialized, [] { glslang::InitializeProcess(); });
+
+    const auto& path  = files.front().path;
+    EShLanguage stage = getStage(path);
+
+    glslang::TShader shader(stage);
+    const char* text = source.c_str();
+    const char* name = path.c_str();
+    int length       = static_cast<int>(source.size());
+    shader.setStringsWithLengthsAndNames(&text, &length, &name, 1);
+    shader.setPreamble(preamble.c_str());
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_2);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_5);
+#ifdef DEBUG
+    shader.setDebugInfo(true);
+#endif
+
+    auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    SourceIncluder includer(files);
+    if (!shader.parse(GetDefaultResources(), 450, false, messages, includer)) {
+        throw std::runtime_error("failed to compile shader " + path + ":\n" + shader.getInfoLog());
+    }
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages)) {
+        throw std::runtime_error("failed to link shader " + path + ":\n" + program.getInfoLog());
+    }
+
+    glslang::SpvOptions options {};
+#ifdef DEBUG
+    options.generateDebugInfo                = true;
+    options.emitNonSemanticShaderDebugInfo   = true;
+    options.emitNonSemanticShaderDebugSource = true;
+#endif
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spirv, &options);
+
+#ifndef DEBUG
+    spvtools::Optimizer optimizer(SPV_ENV_VULKAN_1_2);
+    optimizer.RegisterPerformancePasses();
+    std::vector<uint32_t> optimized;
+    if (optimizer.Run(spirv.data(), spirv.size(), &optimized)) {
+        spirv.swap(optimized);
+    } else {
+        WARN_ALL("spirv-opt failed on " + path + ", using the unoptimized SPIR-V");
+    }
+#endif
+    return spirv;
+}
+
+bool isSpirv(const std::vector<char>& code)
+{
+    uint32_t magic = 0;
+    if (code.size() < sizeof(magic) || code.size() % sizeof(uint32_t) != 0)
+        return false;
+    memcpy(&magic, code.data(), sizeof(magic));
+    return magic == SPIRV_MAGIC;
+}
+}
+
+std::vector<char> compileShader(
+    const std::filesystem::path& path,
+    const ShaderDefines& defines,
+    const std::filesystem::path& cache_directory)
+{
+    std::vector<SourceFile> files;
+    readSources(path, files);
+    std::string preamble;
+    std::string source = applyDefines(files.front().text, defines, preamble);
+
+    StableHash hash;
+    hash.add(COMPILE_OPTIONS);
+    hash.add(preamble);
+    hash.add(source);
+    for (size_t i = 1; i < files.size(); i++) {
+        hash.add(files[i].text);
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash.value));
+    auto cached = cache_directory / (path.filename().string() + "." + hex + ".spv");
+
+    if (std::filesystem::exists(cached)) {
+        auto code = readFile(cached);
+        if (isSpirv(code)) {
+            DEBUG_ALL("shader cache hit: " + cached.string());
+            return code;
+        }
+        WARN_ALL("invalid cached shader " + cached.string() + ", compiling again");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto spirv = compile(files, source, preamble);
+    auto end   = std::chrono::steady_clock::now();
+    INFO_ALL("compiled " + path.string() + " in "
+             + std::to_string(std::chrono::duration<float, std::milli>(end - start).count()) + "ms");
+
+    std::vector<char> code(spirv.size() * sizeof(uint32_t));
+    memcpy(code.data(), spirv.data(), code.size());
+
+    // written under a temporary name first, another thread or process may compile the same shader.
+    // The thread id tells the threads apart, the random part the processes
+    std::filesystem::path temporary;
+    try {
+        std::filesystem::create_directories(cache_directory);
+        temporary = cached;
+        temporary += "." + std::to_string(std::hash<std::thread::id> {}(std::this_thread::get_id())) + "-"
+            + std::to_string(std::random_device {}()) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(code.data(), code.size());
+            file.close();
+            if (!file.good())
+                throw std::runtime_error("failed to write " + temporary.string());
+        }
+        std::filesystem::rename(temporary, cached);
+    } catch (const std::exception& e) {
+        WARN_ALL("failed to cache shader " + cached.string() + ": " + e.what());
+        std::error_code ec;
+        if (!temporary.empty())
+            std::filesystem::remove(temporary, ec);
+    }
+    return code;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+// name, value. Replaces the value of "#define name ..." in the source, or is defined before it
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Compiles a glsl file (stage from the extension) to SPIR-V with glslang and, in release, spirv-opt.
+// Includes are resolved relative to the including file.
+// The SPIR-V is cached in cache_directory under a hash of the source, the included files, the defines
+// and the options, so a warm start doesn't compile at all. Safe to call from several threads.
+std::vector<char> compileShader(
+    const std::filesystem::path& path,
+    const ShaderDefines& defines,
+    const std::filesystem::path& cache_directory);
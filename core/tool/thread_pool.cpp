@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+ThreadPool::~ThreadPool()
+{
+    cleanup();
+}
+
+void ThreadPool::init(uint32_t count)
+{
+    stop = false;
+    for (uint32_t i = 0; i < count; i++) {
+        threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+void ThreadPool::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+std::future<void> ThreadPool::submit(std::function<void(uint32_t)> fn)
+{
+    std::packaged_task<void(uint32_t)> task(std::move(fn));
+    auto future = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace(std::move(task));
+    }
+    condition.notify_one();
+    return future;
+}
+
+void ThreadPool::work(uint32_t worker)
+{
+    while (true) {
+        std::packaged_task<void(uint32_t)> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stop || !tasks.empty(); });
+            if (stop && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task(worker);
+    }
+}
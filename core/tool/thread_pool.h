@@ -0,0 +1,32 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads. A task gets the index of the worker running it,
+// so it can use per-worker resources such as command pools.
+class ThreadPool {
+    void work(uint32_t worker);
+
+    std::vector<std::thread> threads;
+    std::queue<std::packaged_task<void(uint32_t)>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop = false;
+
+public:
+    ~ThreadPool();
+
+    void init(uint32_t count);
+    void cleanup();
+    uint32_t size() const { return static_cast<uint32_t>(threads.size()); }
+
+    // exceptions of the task are rethrown by the future's get()
+    std::future<void> submit(std::function<void(uint32_t)> fn);
+};
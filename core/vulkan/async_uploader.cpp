@@ -0,0 +1,373 @@
+#include "async_uploader.h"
+#include "core/tool/logger.h"
+#include "core/vulkan/type/buffer.h"
+#include "core/vulkan/type/image.h"
+#include "core/vulkan/vulkan_context.h"
+#include "core/vulkan/vulkan_util.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace Vk {
+
+void AsyncUploader::init(const Context* ctx)
+{
+    this->ctx = ctx;
+
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(ctx->device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+
+    if (shared()) {
+        INFO_ALL("async uploads: no transfer queue, going through the staging ring");
+        return;
+    }
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = ctx->queueFamilyIndices.transferFamily.value();
+    if (vkCreateCommandPool(ctx->device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
+    }
+    INFO_ALL("async uploads: transfer queue family " + std::to_string(ctx->queueFamilyIndices.transferFamily.value())
+             + ", graphics queue family " + std::to_string(ctx->queueFamilyIndices.graphicsFamily.value()));
+}
+
+void AsyncUploader::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!in_flight.empty()) {
+            VkSemaphoreWaitInfo waitInfo {};
+            waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores    = &timeline;
+            waitInfo.pValues        = &value;
+            vkWaitSemaphores(ctx->device, &waitInfo, UINT64_MAX);
+        }
+        for (auto& upload : in_flight) {
+            release(upload);
+        }
+        in_flight.clear();
+    }
+    INFO_ALL("async uploader: " + std::to_string(stats.bytes >> 20) + "MB in "
+             + std::to_string(stats.uploads) + " uploads");
+
+    if (pool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(ctx->device, pool, nullptr);
+    vkDestroySemaphore(ctx->device, timeline, nullptr);
+}
+
+bool AsyncUploader::shared() const
+{
+    return ctx->transferQueue == ctx->queue;
+}
+
+AsyncUploader::Upload AsyncUploader::prepare(const void* data, size_t size)
+{
+    Upload upload;
+    createBuffer(
+        *ctx,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        upload.staging, upload.allocation);
+    memcpy(upload.allocation.mapped, data, size);
+    return upload;
+}
+
+VkCommandBuffer AsyncUploader::begin(Upload& upload)
+{
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool        = pool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(ctx->device, &allocInfo, &upload.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(upload.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+    return upload.commandBuffer;
+}
+
+UploadTicket AsyncUploader::submit(Upload& upload)
+{
+    if (vkEndCommandBuffer(upload.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    upload.value = ++value;
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &upload.value;
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &upload.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &timeline;
+    if (vkQueueSubmit(ctx->transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+
+    in_flight.emplace_back(std::move(upload));
+    stats.uploads++;
+    return { value };
+}
+
+void AsyncUploader::release(Upload& upload)
+{
+    vkFreeCommandBuffers(ctx->device, pool, 1, &upload.commandBuffer);
+    vkDestroyBuffer(ctx->device, upload.staging, nullptr);
+    ctx->allocator.free(upload.allocation);
+}
+
+UploadTicket AsyncUploader::upload(const Buffer& dst, const void* data, size_t size, size_t offset,
+                                   const std::function<void(VkCommandBuffer)>& then)
+{
+    if (size + offset > dst.size)
+        throw std::runtime_error("buffer overflow");
+    if ((dst.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) == 0) {
+        throw std::runtime_error("buffer must be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT");
+    }
+
+    if (shared()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ctx->staging.upload(dst, data, size, offset);
+        if (then)
+            ctx->staging.record(then);
+        ctx->staging.signal(timeline, ++value);
+        stats.bytes += size;
+        stats.uploads++;
+        return { value };
+    }
+
+    auto upload = prepare(data, size);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto commandBuffer = begin(upload);
+    copyBuffer(commandBuffer, upload.staging, dst.buffer, size, 0, offset);
+
+    // the copied range moves to the graphics family, the barriers on both sides must match
+    bool transfer_ownership = ctx->queueFamilyIndices.transferFamily != ctx->queueFamilyIndices.graphicsFamily;
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = 0;
+    barrier.srcQueueFamilyIndex = ctx->queueFamilyIndices.transferFamily.value();
+    barrier.dstQueueFamilyIndex = ctx->queueFamilyIndices.graphicsFamily.value();
+    barrier.buffer              = dst.buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+    if (transfer_ownership) {
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0, nullptr,
+            1, &barrier,
+            0, nullptr);
+    }
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    upload.acquire        = [barrier, transfer_ownership, then](VkCommandBuffer commandBuffer) {
+        if (transfer_ownership) {
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                0,
+                0, nullptr,
+                1, &barrier,
+                0, nullptr);
+        }
+        if (then)
+            then(commandBuffer);
+    };
+    stats.bytes += size;
+    return submit(upload);
+}
+
+UploadTicket AsyncUploader::upload(Image& dst, const void* data, VkImageLayout layout)
+{
+    size_t size = formatSize(dst.format) * dst.extent.width * dst.extent.height * dst.extent.depth;
+
+    if (shared()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ctx->staging.upload(dst, data, 0);
+        if (dst.layout != layout) {
+            ctx->staging.record([&](VkCommandBuffer commandBuffer) {
+                transitionImageLayout(commandBuffer, dst.image, dst.format, dst.layout, layout);
+            });
+            dst.layout = layout;
+        }
+        ctx->staging.signal(timeline, ++value);
+        stats.bytes += size;
+        stats.uploads++;
+        return { value };
+    }
+
+    auto upload = prepare(data, size);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto commandBuffer = begin(upload);
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = dst.image;
+    barrier.subresourceRange.aspectMask     = dst.format == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    VkBufferImageCopy region {};
+    region.bufferOffset                    = 0;
+    region.bufferRowLength                 = 0; // Tightly packed
+    region.bufferImageHeight               = 0; // Tightly packed
+    region.imageSubresource.aspectMask     = barrier.subresourceRange.aspectMask;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset                     = { 0, 0, 0 };
+    region.imageExtent                     = dst.extent;
+    vkCmdCopyBufferToImage(commandBuffer, upload.staging, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // the layout transition happens once, between the release and the acquire which both describe it.
+    // In the same family, the semaphore is enough for the graphics queue
+    bool transfer_ownership     = ctx->queueFamilyIndices.transferFamily != ctx->queueFamilyIndices.graphicsFamily;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = 0;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout           = layout;
+    barrier.srcQueueFamilyIndex = transfer_ownership ? ctx->queueFamilyIndices.transferFamily.value() : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = transfer_ownership ? ctx->queueFamilyIndices.graphicsFamily.value() : VK_QUEUE_FAMILY_IGNORED;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    if (transfer_ownership) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        upload.acquire        = [barrier](VkCommandBuffer commandBuffer) {
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+        };
+    }
+    dst.layout = layout;
+    stats.bytes += size;
+    return submit(upload);
+}
+
+void AsyncUploader::poll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (shared() || in_flight.empty())
+        return;
+
+    uint64_t done;
+    vkGetSemaphoreCounterValue(ctx->device, timeline, &done);
+    uint64_t last = acquired;
+    std::vector<std::function<void(VkCommandBuffer)>> acquires;
+    while (!in_flight.empty() && in_flight.front().value <= done) {
+        auto& upload = in_flight.front();
+        if (upload.acquire)
+            acquires.emplace_back(std::move(upload.acquire));
+        acquired = upload.value;
+        release(upload);
+        in_flight.pop_front();
+    }
+    if (acquired == last)
+        return;
+
+    // the value is reached already, the wait orders the acquires after the release
+    ctx->staging.wait(timeline, acquired);
+    if (!acquires.empty()) {
+        ctx->staging.record([&](VkCommandBuffer commandBuffer) {
+            for (auto& acquire : acquires) {
+                acquire(commandBuffer);
+            }
+        });
+    }
+}
+
+bool AsyncUploader::ready(UploadTicket ticket)
+{
+    if (ticket.value == 0)
+        return true;
+
+    if (shared()) {
+        uint64_t done;
+        vkGetSemaphoreCounterValue(ctx->device, timeline, &done);
+        return done >= ticket.value;
+    }
+    poll();
+    std::lock_guard<std::mutex> lock(mutex);
+    return acquired >= ticket.value;
+}
+
+void AsyncUploader::wait(UploadTicket ticket)
+{
+    if (ticket.value == 0)
+        return;
+
+    if (!shared()) {
+        VkSemaphoreWaitInfo waitInfo {};
+        waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &timeline;
+        waitInfo.pValues        = &ticket.value;
+        vkWaitSemaphores(ctx->device, &waitInfo, UINT64_MAX);
+        poll();
+    }
+    // submits the acquires, or the copies and the signal without a transfer queue, and waits for them
+    ctx->staging.execute([](VkCommandBuffer) { });
+}
+
+UploadTicket AsyncUploader::latest()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return { value };
+}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "core/vulkan/memory_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Vk {
+struct Context;
+struct Buffer;
+struct Image;
+
+// Identifies an asynchronous upload, 0 is an upload that is already done
+struct UploadTicket {
+    uint64_t value = 0;
+};
+
+// Uploads on the transfer queue, each submission signals the next value of a timeline semaphore.
+// Once a copy is done, the graphics family acquires the ownership of the destination in the staging
+// ring's batch, which is submitted before the next frame, so the frames are rendered meanwhile.
+// Without a queue of its own, the copies go through the staging ring, which signals the semaphore.
+class AsyncUploader {
+    struct Upload {
+        uint64_t value                = 0;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkBuffer staging              = VK_NULL_HANDLE;
+        Allocation allocation;
+        // recorded on the graphics queue once the copy is done
+        std::function<void(VkCommandBuffer)> acquire;
+    };
+
+    struct Stats {
+        uint64_t bytes   = 0;
+        uint32_t uploads = 0;
+    };
+
+    // the staging buffer, filled with data
+    Upload prepare(const void* data, size_t size);
+    // the mutex is locked by these
+    VkCommandBuffer begin(Upload& upload);
+    UploadTicket submit(Upload& upload);
+    void release(Upload& upload);
+    bool shared() const;
+
+    const Context* ctx;
+    VkCommandPool pool   = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t value       = 0; // signaled by the last submission
+    uint64_t acquired    = 0; // the uploads up to this value are owned by the graphics queue
+    std::deque<Upload> in_flight; // oldest first
+
+    std::mutex mutex;
+    Stats stats;
+
+public:
+    void init(const Context* ctx);
+    // waits for the pending uploads, after the staging ring's cleanup
+    void cleanup();
+
+    // data is copied before returning. The range of dst must not be used by the gpu until the ticket is ready.
+    // then is recorded on the graphics queue right after the ownership is acquired
+    UploadTicket upload(const Buffer& dst, const void* data, size_t size, size_t offset = 0,
+                        const std::function<void(VkCommandBuffer)>& then = {});
+    // the whole mip level 0, the previous content is discarded and dst is left in layout
+    UploadTicket upload(Image& dst, const void* data, VkImageLayout layout);
+
+    // the frames recorded from now on can use the destination
+    bool ready(UploadTicket ticket);
+    // blocks until the upload and its acquire on the graphics queue are done
+    void wait(UploadTicket ticket);
+    // waiting for it waits for all the uploads so far
+    UploadTicket latest();
+    // acquires the finished uploads, called before recording each frame
+    void poll();
+};
+}
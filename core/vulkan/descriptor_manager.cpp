@@ -1,19 +1,55 @@
 #include "descriptor_manager.h"
+#include "core/tool/logger.h"
 #include "core/vulkan/type/buffer.h"
 #include "core/vulkan/vulkan_context.h"
+#include <algorithm>
 #include <array>
+#include <iterator>
 
 namespace Vk {
-void DescriptorManager::init(Context* ctx)
+void DescriptorManager::init(Context* ctx, const Configuration& config)
 {
     this->ctx = ctx;
 
+    initLimits(config);
     initBindlessDescriptors();
-    initBindlessTable();
-    initParameters();
+    initParameters(config);
     initUI();
 }
 
+void DescriptorManager::initLimits(const Configuration& config)
+{
+    const char* keys[TYPE_COUNT] = { "max_uniform_descriptors", "max_storage_descriptors", "max_sampler_descriptors" };
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties {};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(ctx->physicalDevice, &properties);
+    const uint32_t limits[TYPE_COUNT] = {
+        std::min(indexingProperties.maxDescriptorSetUpdateAfterBindUniformBuffers,
+                 indexingProperties.maxPerStageDescriptorUpdateAfterBindUniformBuffers),
+        std::min(indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                 indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers),
+        std::min({ indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                   indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                   indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                   indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers }),
+    };
+
+    for (uint32_t i = 0; i < TYPE_COUNT; ++i) {
+        if (config.contains(keys[i]))
+            MAX_TYPE_DESCRIPTORS[i] = static_cast<uint32_t>(std::max(1, config[keys[i]].get<int>()));
+        uint32_t limit = std::min(limits[i], INDEX_MASK + 1);
+        if (MAX_TYPE_DESCRIPTORS[i] > limit) {
+            WARN_ALL(std::string(keys[i]) + " is clamped to the device limit " + std::to_string(limit));
+            MAX_TYPE_DESCRIPTORS[i] = limit;
+        }
+        tables[i].capacity = MAX_TYPE_DESCRIPTORS[i];
+    }
+}
+
 void DescriptorManager::initBindlessDescriptors()
 {
     std::array<VkDescriptorSetLayoutBinding, TYPE_COUNT> bindings {};
@@ -40,7 +76,7 @@ void DescriptorManager::initBindlessDescriptors()
 
     std::vector<VkDescriptorPoolSize> poolSize {};
     for (uint32_t i = 0; i < TYPE_COUNT; ++i) {
-        poolSize.emplace_back(VkDescriptorPoolSize { types[i], static_cast<uint32_t>(MAX_TYPE_DESCRIPTORS[i]) });
+        poolSize.emplace_back(VkDescriptorPoolSize { types[i], MAX_TYPE_DESCRIPTORS[i] });
     }
     VkDescriptorPoolCreateInfo poolInfo {};
     poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -62,22 +98,27 @@ void DescriptorManager::initBindlessDescriptors()
     }
 }
 
-void DescriptorManager::initBindlessTable()
+void DescriptorManager::initParameters(const Configuration& config)
 {
-    for (uint32_t i = 0; i < TYPE_COUNT; ++i) {
-        const auto& type       = static_cast<DescriptorType>(i);
-        allocatedHandles[type] = {};
-        freeHandles[type].reserve(MAX_TYPE_DESCRIPTORS[i]);
-        for (uint32_t j = 0; j < MAX_TYPE_DESCRIPTORS[i]; ++j)
-            freeHandles[type].insert(static_cast<DescriptorHandle>(j));
-    }
-}
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &properties);
+    parameterAlignment = std::max(parameterAlignment,
+                                  static_cast<uint32_t>(properties.limits.minUniformBufferOffsetAlignment));
+    if (config.contains("parameter_buffer_size"))
+        parameterCapacity = static_cast<uint32_t>(std::max(1, config["parameter_buffer_size"].get<int>())) << 10;
+    parameterCapacity = (parameterCapacity + parameterAlignment - 1) / parameterAlignment * parameterAlignment;
+    parameterFree[0] = parameterCapacity;
+
+    // every bound offset needs MAX_PARAMETER_SIZE bytes after it
+    parameterBuffer = Buffer::New(
+        *ctx,
+        parameterCapacity + MAX_PARAMETER_SIZE,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-void DescriptorManager::initParameters()
-{
     VkDescriptorSetLayoutBinding layoutBinding = {};
     layoutBinding.binding                      = 0;
-    layoutBinding.descriptorType               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layoutBinding.descriptorType               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     layoutBinding.descriptorCount              = 1;
     layoutBinding.stageFlags                   = VK_SHADER_STAGE_ALL;
 
@@ -90,18 +131,41 @@ void DescriptorManager::initParameters()
     }
 
     VkDescriptorPoolSize poolSize {};
-    poolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = parameterPoolSize;
+    poolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo {};
     poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = 1;
     poolInfo.pPoolSizes    = &poolSize;
-    poolInfo.maxSets       = parameterPoolSize;
-    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets       = 1;
     if (vkCreateDescriptorPool(ctx->device, &poolInfo, nullptr, &parameterPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
     }
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = parameterPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &parameterLayout;
+    if (vkAllocateDescriptorSets(ctx->device, &allocInfo, &parameterSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo {};
+    bufferInfo.buffer = parameterBuffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range  = MAX_PARAMETER_SIZE;
+
+    VkWriteDescriptorSet descriptorWrite {};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = parameterSet;
+    descriptorWrite.dstBinding      = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.pBufferInfo     = &bufferInfo;
+    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
 }
 
 void DescriptorManager::initUI()
@@ -121,260 +185,251 @@ void DescriptorManager::initUI()
     }
 }
 
-DescriptorHandle DescriptorManager::registerResource(const Image& image, DescriptorType type)
+DescriptorHandle DescriptorManager::allocateHandle(const uuid::UUID& id, DescriptorType type)
 {
-    assert(image.id != uuid::nil_uuid());
-    assert(type == DescriptorType::CombinedImageSampler);
-    if (freeHandles[type].empty()) {
-        assert(allocatedHandles[type].size() == MAX_TYPE_DESCRIPTORS[static_cast<uint32_t>(type)]);
+    assert(id != uuid::nil_uuid());
+    if (handles.find(id) != handles.end())
+        throw std::runtime_error("register the same uuid again!");
+
+    auto& table = tables[static_cast<uint32_t>(type)];
+    uint32_t index;
+    if (!table.free.empty()) {
+        index = table.free.back();
+        table.free.pop_back();
+    } else if (table.slots.size() < table.capacity) {
+        index = static_cast<uint32_t>(table.slots.size());
+        table.slots.emplace_back();
+    } else {
         throw std::runtime_error("failed to allocate descriptor handle!");
     }
-    assert(allocatedHandles[type].size() < MAX_TYPE_DESCRIPTORS[static_cast<uint32_t>(type)]);
 
-    const auto handle = *freeHandles[type].begin();
-    freeHandles[type].erase(freeHandles[type].begin());
-    allocatedHandles[type][image.id] = handle;
-    nameToType[image.id]             = type;
+    auto& slot  = table.slots[index];
+    slot.id     = id;
+    slot.used   = true;
+    auto handle = makeHandle(type, slot.generation, index);
+    handles[id] = handle;
+    return handle;
+}
 
+DescriptorManager::Slot* DescriptorManager::findSlot(DescriptorHandle handle)
+{
+    if (handle == DescriptorHandle::Null)
+        return nullptr;
+    auto type = static_cast<uint32_t>(handleType(handle));
+    if (type >= TYPE_COUNT)
+        return nullptr;
+    auto& table    = tables[type];
+    uint32_t index = handleIndex(handle);
+    if (index >= table.slots.size())
+        return nullptr;
+    auto& slot = table.slots[index];
+    if (!slot.used || slot.generation != ((static_cast<uint32_t>(handle) >> INDEX_BITS) & GENERATION_MASK))
+        return nullptr;
+    return &slot;
+}
+
+void DescriptorManager::queueWrite(DescriptorHandle handle, const Image& image)
+{
     assert(image.sampler != VK_NULL_HANDLE);
-    VkDescriptorImageInfo imageInfo {};
-    imageInfo.imageLayout = image.layout;
-    imageInfo.imageView   = image.view;
-    imageInfo.sampler     = image.sampler;
+    PendingWrite write {};
+    write.handle            = handle;
+    write.image.imageLayout = image.layout;
+    write.image.imageView   = image.view;
+    write.image.sampler     = image.sampler;
+    queueWrite(write);
+}
 
-    VkWriteDescriptorSet descriptorWrite {};
-    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet          = bindlessSet;
-    descriptorWrite.dstBinding      = static_cast<uint32_t>(type);
-    descriptorWrite.dstArrayElement = static_cast<uint32_t>(handle);
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.pImageInfo      = &imageInfo;
-    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
+void DescriptorManager::queueWrite(DescriptorHandle handle, const Buffer& buffer)
+{
+    PendingWrite write {};
+    write.handle        = handle;
+    write.buffer.buffer = buffer.buffer;
+    write.buffer.offset = 0;
+    write.buffer.range  = VK_WHOLE_SIZE;
+    queueWrite(write);
+}
 
+void DescriptorManager::queueWrite(const PendingWrite& write)
+{
+    // an earlier write to the same handle may refer to a destroyed view or buffer
+    auto it = std::find_if(pendingWrites.begin(), pendingWrites.end(), [&](const PendingWrite& w) {
+        return w.handle == write.handle;
+    });
+    if (it != pendingWrites.end())
+        *it = write;
+    else
+        pendingWrites.emplace_back(write);
+}
+
+DescriptorHandle DescriptorManager::registerResource(const Image& image, DescriptorType type)
+{
+    assert(type == DescriptorType::CombinedImageSampler);
+    const auto handle = allocateHandle(image.id, type);
+    queueWrite(handle, image);
     return handle;
 }
 
 DescriptorHandle DescriptorManager::registerResource(const Buffer& buffer, DescriptorType type)
 {
-    assert(buffer.id != uuid::nil_uuid());
     assert(type == DescriptorType::Uniform || type == DescriptorType::Storage);
-    if (freeHandles[type].empty()) {
-        assert(allocatedHandles[type].size() == MAX_TYPE_DESCRIPTORS[static_cast<uint32_t>(type)]);
-        throw std::runtime_error("failed to allocate descriptor handle!");
-    }
-    assert(allocatedHandles[type].size() < MAX_TYPE_DESCRIPTORS[static_cast<uint32_t>(type)]);
-
-    const auto handle = *freeHandles[type].begin();
-    freeHandles[type].erase(freeHandles[type].begin());
-    allocatedHandles[type][buffer.id] = handle;
-    nameToType[buffer.id]             = type;
-
-    VkDescriptorBufferInfo bufferInfo {};
-    bufferInfo.buffer = buffer.buffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range  = VK_WHOLE_SIZE;
-
-    VkWriteDescriptorSet descriptorWrite {};
-    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet          = bindlessSet;
-    descriptorWrite.dstBinding      = static_cast<uint32_t>(type);
-    descriptorWrite.dstArrayElement = static_cast<uint32_t>(handle);
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo     = &bufferInfo;
-    if (type == DescriptorType::Uniform)
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    if (type == DescriptorType::Storage)
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
-
+    const auto handle = allocateHandle(buffer.id, type);
+    queueWrite(handle, buffer);
     return handle;
 }
 
 void DescriptorManager::updateResourceRegistration(const Image& image)
 {
-    assert(image.id != uuid::nil_uuid());
-    const auto& type = nameToType.find(image.id);
-    if (type == nameToType.end())
-        throw std::runtime_error("failed to find the descriptor!");
-    const auto& handle = allocatedHandles[type->second].find(image.id);
-    if (handle == allocatedHandles[type->second].end())
-        throw std::runtime_error("failed to find the descriptor!");
-
-    assert(image.sampler != VK_NULL_HANDLE);
-    VkDescriptorImageInfo imageInfo {};
-    imageInfo.imageLayout = image.layout;
-    imageInfo.imageView   = image.view;
-    imageInfo.sampler     = image.sampler;
-
-    VkWriteDescriptorSet descriptorWrite {};
-    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet          = bindlessSet;
-    descriptorWrite.dstBinding      = static_cast<uint32_t>(type->second);
-    descriptorWrite.dstArrayElement = static_cast<uint32_t>(handle->second);
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.pImageInfo      = &imageInfo;
-    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
+    auto handle = getResourceHandle(image.id);
+    assert(handleType(handle) == DescriptorType::CombinedImageSampler);
+    queueWrite(handle, image);
 }
 
 void DescriptorManager::updateResourceRegistration(const Buffer& buffer)
 {
-    assert(buffer.id != uuid::nil_uuid());
-    const auto& type = nameToType.find(buffer.id);
-    if (type == nameToType.end())
-        throw std::runtime_error("failed to find the descriptor!");
-    const auto& handle = allocatedHandles[type->second].find(buffer.id);
-    if (handle == allocatedHandles[type->second].end())
-        throw std::runtime_error("failed to find the descriptor!");
-
-    VkDescriptorBufferInfo bufferInfo {};
-    bufferInfo.buffer = buffer.buffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range  = VK_WHOLE_SIZE;
-
-    VkWriteDescriptorSet descriptorWrite {};
-    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet          = bindlessSet;
-    descriptorWrite.dstBinding      = static_cast<uint32_t>(type->second);
-    descriptorWrite.dstArrayElement = static_cast<uint32_t>(handle->second);
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo     = &bufferInfo;
-    if (type->second == DescriptorType::Uniform)
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    if (type->second == DescriptorType::Storage)
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
+    auto handle = getResourceHandle(buffer.id);
+    assert(handleType(handle) != DescriptorType::CombinedImageSampler);
+    queueWrite(handle, buffer);
 }
 
 DescriptorHandle DescriptorManager::getResourceHandle(const uuid::UUID& id)
 {
     assert(id != uuid::nil_uuid());
-    const auto& type = nameToType.find(id);
-    if (type == nameToType.end())
-        throw std::runtime_error("failed to find the descriptor!");
-    const auto& handle = allocatedHandles[type->second].find(id);
-    if (handle == allocatedHandles[type->second].end())
+    const auto& handle = handles.find(id);
+    if (handle == handles.end())
         throw std::runtime_error("failed to find the descriptor!");
     return handle->second;
 }
 
 void DescriptorManager::removeResourceRegistration(const uuid::UUID& id)
 {
-    assert(id != uuid::nil_uuid());
-    const auto& type = nameToType.find(id);
-    if (type == nameToType.end())
-        throw std::runtime_error("failed to find the descriptor!");
-    const auto& handle = allocatedHandles[type->second].find(id);
-    if (handle == allocatedHandles[type->second].end())
-        throw std::runtime_error("failed to find the descriptor!");
-    freeHandles[type->second].emplace(handle->second);
-    allocatedHandles[type->second].erase(id);
-    nameToType.erase(id);
+    const auto handle = getResourceHandle(id);
+    auto& table       = tables[static_cast<uint32_t>(handleType(handle))];
+    auto& slot        = table.slots[handleIndex(handle)];
+    slot.id           = uuid::nil_uuid();
+    slot.used         = false;
+    slot.generation   = (slot.generation + 1) & GENERATION_MASK;
+    table.retired.emplace_back(handleIndex(handle), flushes);
+    handles.erase(id);
 }
 
-void DescriptorManager::resizeParameterPool()
+bool DescriptorManager::isValid(DescriptorHandle handle)
 {
-    auto new_size = parameterPoolSize * 2;
+    return findSlot(handle) != nullptr;
+}
 
-    VkDescriptorPool new_pool;
-    VkDescriptorPoolSize poolSize {};
-    poolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = new_size;
-    VkDescriptorPoolCreateInfo poolInfo {};
-    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes    = &poolSize;
-    poolInfo.maxSets       = new_size;
-    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
-    if (vkCreateDescriptorPool(ctx->device, &poolInfo, nullptr, &new_pool) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor pool!");
+void DescriptorManager::flush()
+{
+    flushes++;
+    for (auto& table : tables) {
+        // the frames recorded before the removal are done after MAX_FRAMES_IN_FLIGHT more
+        auto it = std::partition(table.retired.begin(), table.retired.end(), [&](const auto& r) {
+            return r.second + ctx->MAX_FRAMES_IN_FLIGHT >= flushes;
+        });
+        for (auto r = it; r != table.retired.end(); r++) {
+            table.free.emplace_back(r->first);
+        }
+        table.retired.erase(it, table.retired.end());
     }
-
-    std::vector<VkDescriptorSet> sets(new_size);
-    VkDescriptorSetAllocateInfo allocInfo {};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = new_pool;
-    allocInfo.descriptorSetCount = sets.size();
-    allocInfo.pSetLayouts        = &parameterLayout;
-    if (vkAllocateDescriptorSets(ctx->device, &allocInfo, sets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor sets!");
+    auto retired = std::partition(parameterRetired.begin(), parameterRetired.end(), [&](const auto& r) {
+        return r.second + ctx->MAX_FRAMES_IN_FLIGHT >= flushes;
+    });
+    for (auto r = retired; r != parameterRetired.end(); r++) {
+        freeParameter(r->first);
     }
-    std::vector<VkCopyDescriptorSet> copies(sets.size());
-    int i = 0;
-    for (auto& p : parameterSet) {
-        copies[i].sType           = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-        copies[i].srcSet          = p.second; // Source descriptor set
-        copies[i].srcBinding      = 0; // Source binding
-        copies[i].srcArrayElement = 0; // Starting array index in source
-        copies[i].dstSet          = sets[i]; // Destination descriptor set
-        copies[i].dstBinding      = 0; // Destination binding
-        copies[i].dstArrayElement = 0; // Starting array index in destination
-        copies[i].descriptorCount = 1; // Number of descriptors to copy
-
-        p.second = sets[i];
-        i++;
+    parameterRetired.erase(retired, parameterRetired.end());
+
+    if (pendingWrites.empty())
+        return;
+
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(pendingWrites.size());
+    for (const auto& pending : pendingWrites) {
+        // removed before it was written
+        if (findSlot(pending.handle) == nullptr)
+            continue;
+
+        auto type = handleType(pending.handle);
+        VkWriteDescriptorSet descriptorWrite {};
+        descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet          = bindlessSet;
+        descriptorWrite.dstBinding      = static_cast<uint32_t>(type);
+        descriptorWrite.dstArrayElement = handleIndex(pending.handle);
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType  = types[static_cast<uint32_t>(type)];
+        if (type == DescriptorType::CombinedImageSampler)
+            descriptorWrite.pImageInfo = &pending.image;
+        else
+            descriptorWrite.pBufferInfo = &pending.buffer;
+        writes.emplace_back(descriptorWrite);
     }
-    vkUpdateDescriptorSets(ctx->device, 0, nullptr, copies.size(), copies.data());
-
-    vkDestroyDescriptorPool(ctx->device, parameterPool, nullptr);
-    parameterPool     = new_pool;
-    parameterPoolSize = new_size;
+    vkUpdateDescriptorSets(ctx->device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    pendingWrites.clear();
 }
 
-void DescriptorManager::registerParameter(const Buffer& buffer)
+ParameterBlock DescriptorManager::allocateParameter(size_t size)
 {
-    assert(buffer.id != uuid::nil_uuid());
-    if (parameterSet.find(buffer.id) != parameterSet.end())
-        throw std::runtime_error("register the same uuid again!");
-
-    if (parameterSet.size() == parameterPoolSize)
-        resizeParameterPool();
-
-    VkDescriptorSet desc_set;
-    VkDescriptorSetAllocateInfo allocInfo {};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = parameterPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts        = &parameterLayout;
-    if (vkAllocateDescriptorSets(ctx->device, &allocInfo, &desc_set) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor sets!");
+    if (size == 0 || size > MAX_PARAMETER_SIZE)
+        throw std::runtime_error("parameter block is too large!");
+    uint32_t aligned = (static_cast<uint32_t>(size) + parameterAlignment - 1) / parameterAlignment * parameterAlignment;
+
+    auto best = parameterFree.end();
+    for (auto it = parameterFree.begin(); it != parameterFree.end(); it++) {
+        if (it->second < aligned)
+            continue;
+        if (best == parameterFree.end() || it->second < best->second)
+            best = it;
     }
-    VkDescriptorBufferInfo bufferInfo {};
-    bufferInfo.buffer = buffer.buffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range  = VK_WHOLE_SIZE;
+    if (best == parameterFree.end())
+        throw std::runtime_error("failed to allocate parameter block!");
+
+    ParameterBlock block;
+    block.offset = best->first;
+    block.size   = aligned;
+    if (best->second > aligned)
+        parameterFree[best->first + aligned] = best->second - aligned;
+    parameterFree.erase(best);
+    return block;
+}
 
-    VkWriteDescriptorSet descriptorWrite {};
-    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet          = desc_set;
-    descriptorWrite.dstBinding      = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrite.pBufferInfo     = &bufferInfo;
-    vkUpdateDescriptorSets(ctx->device, 1, &descriptorWrite, 0, nullptr);
+void DescriptorManager::freeParameter(const ParameterBlock& block)
+{
+    // merge with the free neighbours
+    uint32_t offset = block.offset;
+    uint32_t size   = block.size;
+    auto next       = parameterFree.lower_bound(offset);
+    if (next != parameterFree.end() && next->first == offset + size) {
+        size += next->second;
+        next = parameterFree.erase(next);
+    }
+    if (next != parameterFree.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            parameterFree.erase(prev);
+        }
+    }
+    parameterFree[offset] = size;
+}
 
-    parameterSet[buffer.id] = desc_set;
+void DescriptorManager::updateParameter(const ParameterBlock& block, const void* data, size_t size)
+{
+    assert(block.valid() && size <= block.size);
+    parameterBuffer.Update(*ctx, data, size, block.offset);
 }
 
-VkDescriptorSet* DescriptorManager::getParameterSet(const uuid::UUID& uuid)
+void DescriptorManager::updateParameterDeferred(const ParameterBlock& block, const void* data, size_t size)
 {
-    assert(uuid != uuid::nil_uuid());
-    const auto it = parameterSet.find(uuid);
-    if (it == parameterSet.end())
-        throw std::runtime_error("failed to find the descriptor set!");
-    return &it->second;
+    assert(block.valid() && size <= block.size);
+    parameterBuffer.UpdateDeferred(*ctx, data, size, block.offset);
 }
 
-void DescriptorManager::removeParameter(const uuid::UUID& uuid)
+void DescriptorManager::removeParameter(ParameterBlock& block)
 {
-    assert(uuid != uuid::nil_uuid());
-    const auto it = parameterSet.find(uuid);
-    if (it == parameterSet.end())
-        throw std::runtime_error("failed to find the descriptor set!");
-    vkFreeDescriptorSets(ctx->device, parameterPool, 1, &it->second);
-    parameterSet.erase(it);
+    if (!block.valid())
+        return;
+    parameterRetired.emplace_back(block, flushes);
+    block = ParameterBlock {};
 }
 
 void DescriptorManager::cleanup()
@@ -384,6 +439,7 @@ void DescriptorManager::cleanup()
 
     vkDestroyDescriptorSetLayout(ctx->device, parameterLayout, nullptr);
     vkDestroyDescriptorPool(ctx->device, parameterPool, nullptr);
+    Buffer::Delete(*ctx, parameterBuffer);
 
     vkDestroyDescriptorPool(ctx->device, uiPool, nullptr);
 }
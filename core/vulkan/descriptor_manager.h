@@ -1,17 +1,22 @@
 #pragma once
 
+#include "core/config/config.h"
+#include "core/vulkan/type/buffer.h"
 #include "core/vulkan/type/image.h"
 #include <array>
 #include <boost/uuid/uuid.hpp>
 #include <core/tool/uuid.h>
+#include <map>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace Vk {
 
 struct Context;
 
+// The type in the top 2 bits, a generation in the next 10 and the index in the bindless array of the type in the
+// low 20. A handle of a removed resource is detected by its generation. The shaders use HandleIndex (common.glsl)
 enum class DescriptorHandle : uint32_t {
     Null = static_cast<uint32_t>(-1),
 };
@@ -24,63 +29,133 @@ enum class DescriptorType : uint8_t {
     Count = 3,
 };
 
+// A range of the parameter buffer. All the blocks share one descriptor set, a block is bound with its dynamic offset
+struct ParameterBlock {
+    uint32_t offset = UINT32_MAX;
+    uint32_t size   = 0;
+
+    bool valid() const { return offset != UINT32_MAX; }
+};
+
 class DescriptorManager {
+    struct Slot {
+        uuid::UUID id       = uuid::nil_uuid();
+        uint32_t generation = 0;
+        bool used           = false;
+    };
+
+    // the slots of one bindless array, handed out from the free list first, then from the end
+    struct Table {
+        std::vector<Slot> slots;
+        std::vector<uint32_t> free;
+        // removed ones are reused once the frames in flight that may read them are done
+        std::vector<std::pair<uint32_t, uint64_t>> retired; // index, flush count at removal
+        uint32_t capacity = 0;
+    };
+
+    struct PendingWrite {
+        DescriptorHandle handle;
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+    };
+
+    void initLimits(const Configuration& config);
     void initBindlessDescriptors();
-    void initBindlessTable();
-    void initParameters();
+    void initParameters(const Configuration& config);
     void initUI();
 
-    void resizeParameterPool();
+    void freeParameter(const ParameterBlock& block);
+
+    DescriptorHandle allocateHandle(const uuid::UUID& id, DescriptorType type);
+    // the slot of a live handle, nullptr if it was removed
+    Slot* findSlot(DescriptorHandle handle);
+    void queueWrite(DescriptorHandle handle, const Image& image);
+    void queueWrite(DescriptorHandle handle, const Buffer& buffer);
+    void queueWrite(const PendingWrite& write);
+
+    static DescriptorHandle makeHandle(DescriptorType type, uint32_t generation, uint32_t index)
+    {
+        return static_cast<DescriptorHandle>((static_cast<uint32_t>(type) << (INDEX_BITS + GENERATION_BITS))
+                                             | (generation << INDEX_BITS) | index);
+    }
 
     Context* ctx;
 
     VkDescriptorPool bindlessPool;
     VkDescriptorSetLayout bindlessLayout;
     VkDescriptorSet bindlessSet;
-    std::unordered_map<DescriptorType, std::unordered_set<DescriptorHandle>> freeHandles;
-    std::unordered_map<DescriptorType, std::unordered_map<uuid::UUID, DescriptorHandle>> allocatedHandles;
-    std::unordered_map<uuid::UUID, DescriptorType> nameToType;
-
+    std::array<Table, static_cast<size_t>(DescriptorType::Count)> tables;
+    // the handle of a registered resource, for the code that holds the resource and not its handle: the nodes,
+    // materials, objects and fields filling their parameters when they are created, and the update and removal
+    // of a registration. Parameters and shaders only keep the handles, nothing is looked up here per frame
+    std::unordered_map<uuid::UUID, DescriptorHandle> handles;
+    std::vector<PendingWrite> pendingWrites;
+    uint64_t flushes = 0;
+
+    // one device local buffer holds the parameters of all the pipelines and fields
+    Buffer parameterBuffer;
     VkDescriptorPool parameterPool;
     VkDescriptorSetLayout parameterLayout;
-    std::unordered_map<uuid::UUID, VkDescriptorSet> parameterSet;
-    uint32_t parameterPoolSize = 128;
+    VkDescriptorSet parameterSet;
+    std::map<uint32_t, uint32_t> parameterFree; // offset to size
+    std::vector<std::pair<ParameterBlock, uint64_t>> parameterRetired; // block, flush count at removal
+    uint32_t parameterAlignment = 256; // minUniformBufferOffsetAlignment
+    uint32_t parameterCapacity  = 1 << 20;
 
 public:
     DescriptorManager() = default;
-    void init(Context* ctx);
+    void init(Context* ctx, const Configuration& config);
 
+    // the descriptor is written by the next flush
     DescriptorHandle registerResource(const Image& image, DescriptorType type = DescriptorType::CombinedImageSampler);
     DescriptorHandle registerResource(const Buffer& buffer, DescriptorType type);
     void updateResourceRegistration(const Image& image);
     void updateResourceRegistration(const Buffer& buffer);
     DescriptorHandle getResourceHandle(const uuid::UUID& id);
+    bool isRegistered(const uuid::UUID& id) const { return handles.find(id) != handles.end(); }
     void removeResourceRegistration(const uuid::UUID& id);
+    // false once its resource is removed
+    bool isValid(DescriptorHandle handle);
+    // writes the registrations and updates since the last call in one vkUpdateDescriptorSets, before each frame
+    void flush();
     constexpr VkDescriptorSet* BINDLESS_SET() { return &bindlessSet; }
     constexpr VkDescriptorSetLayout BINDLESS_LAYOUT() { return bindlessLayout; }
 
-    void registerParameter(const Buffer& buffer);
-    void removeParameter(const uuid::UUID& uuid);
-    VkDescriptorSet* getParameterSet(const uuid::UUID& uuid);
+    // at most MAX_PARAMETER_SIZE bytes
+    ParameterBlock allocateParameter(size_t size);
+    // copied through the staging ring before the next frame, for the parameters written once
+    void updateParameter(const ParameterBlock& block, const void* data, size_t size);
+    // applied at the beginning of the next recorded frame, like Buffer::UpdateDeferred
+    void updateParameterDeferred(const ParameterBlock& block, const void* data, size_t size);
+    // the range is reused once the frames in flight that may read it are done
+    void removeParameter(ParameterBlock& block);
+    // bound with the offset of a block, see RenderGraphNode::bindParameter
+    constexpr VkDescriptorSet* PARAMETER_SET() { return &parameterSet; }
     constexpr VkDescriptorSetLayout PARAMETER_LAYOUT() const { return parameterLayout; }
 
     void cleanup();
 
-    static constexpr size_t MAX_UNIFORM_DESCRIPTORS                = 1024;
-    static constexpr size_t MAX_STORAGE_DESCRIPTORS                = 1024;
-    static constexpr size_t MAX_COMBINED_IMAGE_SAMPLER_DESCRIPTORS = 1024;
-    static constexpr size_t TYPE_COUNT                             = static_cast<size_t>(DescriptorType::Count);
-    static constexpr size_t MAX_TYPE_DESCRIPTORS[TYPE_COUNT]       = {
-        MAX_UNIFORM_DESCRIPTORS,
-        MAX_STORAGE_DESCRIPTORS,
-        MAX_COMBINED_IMAGE_SAMPLER_DESCRIPTORS,
-    };
+    static constexpr uint32_t INDEX_BITS      = 20;
+    static constexpr uint32_t GENERATION_BITS = 10;
+    static constexpr uint32_t INDEX_MASK      = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+    static constexpr size_t TYPE_COUNT        = static_cast<size_t>(DescriptorType::Count);
+    // the range of the dynamic uniform buffer descriptor, so the largest parameter block
+    static constexpr uint32_t MAX_PARAMETER_SIZE = 1024;
+    // the size of the bindless arrays, from the configuration, clamped to the device limits
+    std::array<uint32_t, TYPE_COUNT> MAX_TYPE_DESCRIPTORS = { 1024, 1024, 1024 };
     static constexpr std::array<VkDescriptorType, TYPE_COUNT> types {
         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
     };
 
+    static uint32_t handleIndex(DescriptorHandle handle) { return static_cast<uint32_t>(handle) & INDEX_MASK; }
+    static DescriptorType handleType(DescriptorHandle handle)
+    {
+        return static_cast<DescriptorType>(static_cast<uint32_t>(handle) >> (INDEX_BITS + GENERATION_BITS));
+    }
+
     VkDescriptorPool uiPool;
 };
 
@@ -0,0 +1,164 @@
+#include "frame_uploader.h"
+#include "core/vulkan/type/buffer.h"
+#include "core/vulkan/vulkan_context.h"
+#include "core/vulkan/vulkan_util.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Vk {
+
+void FrameUploader::init(const Context* ctx, uint32_t frame_count)
+{
+    this->ctx = ctx;
+    stagings.resize(frame_count);
+}
+
+void FrameUploader::cleanup()
+{
+    for (auto& staging : stagings) {
+        release(staging);
+    }
+    stagings.clear();
+}
+
+void FrameUploader::reserve(Staging& staging, size_t size)
+{
+    if (staging.size >= size)
+        return;
+
+    release(staging);
+    staging.size = std::max(MIN_STAGING_SIZE, size * 2);
+    createBuffer(
+        *ctx,
+        staging.size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        staging.buffer, staging.allocation);
+    staging.mapped = staging.allocation.mapped;
+}
+
+void FrameUploader::release(Staging& staging)
+{
+    if (staging.buffer == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyBuffer(ctx->device, staging.buffer, nullptr);
+    ctx->allocator.free(staging.allocation);
+    staging = Staging {};
+}
+
+void FrameUploader::push(const Buffer& dst, const void* data, size_t size, size_t offset)
+{
+    if (size + offset > dst.size)
+        throw std::runtime_error("buffer overflow");
+    if ((dst.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) == 0)
+        throw std::runtime_error("buffer must be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT");
+
+    auto& same_dst = pending_by_dst[dst.buffer];
+    for (auto it = same_dst.rbegin(); it != same_dst.rend(); it++) {
+        auto& region = pending_regions[*it];
+        if (region.dst_offset == offset && region.size == size) {
+            // the latest write to the same range is the only one that matters
+            memcpy(pending_data.data() + region.src_offset, data, size);
+            return;
+        }
+        if (region.dst_offset < offset + size && offset < region.dst_offset + region.size) {
+            batch++;
+            break;
+        }
+    }
+
+    Region region {
+        dst.buffer,
+        pending_data.size(),
+        offset,
+        size,
+        batch,
+    };
+    pending_data.insert(pending_data.end(), (const char*)data, (const char*)data + size);
+    same_dst.emplace_back(static_cast<uint32_t>(pending_regions.size()));
+    pending_regions.emplace_back(region);
+}
+
+void FrameUploader::discard(const Buffer& dst)
+{
+    if (pending_by_dst.erase(dst.buffer) == 0)
+        return;
+
+    // the data of the dropped regions stays in pending_data until the flush, the other regions are renumbered
+    pending_regions.erase(
+        std::remove_if(pending_regions.begin(), pending_regions.end(), [&](const Region& region) { return region.dst == dst.buffer; }),
+        pending_regions.end());
+    pending_by_dst.clear();
+    for (uint32_t i = 0; i < pending_regions.size(); i++) {
+        pending_by_dst[pending_regions[i].dst].emplace_back(i);
+    }
+}
+
+void FrameUploader::flush(VkCommandBuffer commandBuffer, uint32_t frame_index)
+{
+    if (pending_regions.empty())
+        return;
+
+    // the previous use of this staging buffer has finished since the fence is signaled
+    auto& staging = stagings[frame_index];
+    reserve(staging, pending_data.size());
+    memcpy(staging.mapped, pending_data.data(), pending_data.size());
+
+    // earlier frames may still read the destinations, indirect draw commands and copies of them included
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr);
+
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    uint32_t current_batch = pending_regions.front().batch;
+    for (const auto& region : pending_regions) {
+        if (region.batch != current_batch) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+            current_batch = region.batch;
+        }
+
+        VkBufferCopy copy {};
+        copy.srcOffset = region.src_offset;
+        copy.dstOffset = region.dst_offset;
+        copy.size      = region.size;
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, region.dst, 1, &copy);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+        | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+
+    pending_data.clear();
+    pending_regions.clear();
+    pending_by_dst.clear();
+    batch = 0;
+}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "core/vulkan/memory_allocator.h"
+#include <vulkan/vulkan.h>
+
+namespace Vk {
+struct Context;
+struct Buffer;
+
+// Updates of buffers that frames still in flight may be reading.
+// The data is kept on the cpu until the next frame is recorded, then it is copied to
+// that frame's staging buffer and transferred by a command buffer submitted before the frame's.
+class FrameUploader {
+    struct Region {
+        VkBuffer dst;
+        size_t src_offset;
+        size_t dst_offset;
+        size_t size;
+        uint32_t batch; // overlapping writes to the same buffer need a barrier in between
+    };
+
+    struct Staging {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        void* mapped    = nullptr;
+        size_t size     = 0;
+    };
+
+    void reserve(Staging& staging, size_t size);
+    void release(Staging& staging);
+
+    const Context* ctx;
+    std::vector<Staging> stagings; // one per frame in flight
+    std::vector<char> pending_data;
+    std::vector<Region> pending_regions;
+    std::unordered_map<VkBuffer, std::vector<uint32_t>> pending_by_dst;
+    uint32_t batch = 0;
+
+    static constexpr size_t MIN_STAGING_SIZE = 64 * 1024;
+
+public:
+    void init(const Context* ctx, uint32_t frame_count);
+    void cleanup();
+
+    void push(const Buffer& dst, const void* data, size_t size, size_t offset);
+    // drops the pending writes to dst, before it is destroyed
+    void discard(const Buffer& dst);
+    bool pending() const { return !pending_regions.empty(); }
+    // Should be called after the fence of this frame is signaled
+    void flush(VkCommandBuffer commandBuffer, uint32_t frame_index);
+};
+}
@@ -0,0 +1,240 @@
+#include "memory_allocator.h"
+#include "core/tool/logger.h"
+#include "core/vulkan/vulkan_context.h"
+#include "core/vulkan/vulkan_util.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace Vk {
+
+void MemoryAllocator::init(const Context* ctx)
+{
+    this->ctx = ctx;
+    vkGetPhysicalDeviceMemoryProperties(ctx->physicalDevice, &memory_properties);
+    pools.resize(memory_properties.memoryTypeCount * 2);
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &device_properties);
+    max_allocations = device_properties.limits.maxMemoryAllocationCount;
+
+    // small heaps (e.g. the host visible device local one) get smaller blocks
+    block_sizes.resize(memory_properties.memoryTypeCount);
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        VkDeviceSize heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[i].heapIndex].size;
+        block_sizes[i]         = heap_size < (1ull << 30) ? std::min(BLOCK_SIZE, heap_size / 8) : BLOCK_SIZE;
+    }
+}
+
+void MemoryAllocator::cleanup()
+{
+    auto s = collect();
+    if (s.allocations != 0 || s.dedicated != 0) {
+        WARN_ALL("memory allocator: " + std::to_string(s.allocations + s.dedicated) + " allocations are not freed");
+    }
+    for (auto& pool : pools) {
+        for (auto& block : pool.blocks) {
+            if (block.memory == VK_NULL_HANDLE)
+                continue;
+            if (block.mapped != nullptr)
+                vkUnmapMemory(ctx->device, block.memory);
+            vkFreeMemory(ctx->device, block.memory, nullptr);
+        }
+    }
+    pools.clear();
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t type, const void* pNext, void** mapped)
+{
+    VkMemoryAllocateInfo allocInfo {};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext           = pNext;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = type;
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(ctx->device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    *mapped = nullptr;
+    if ((memory_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+        vkMapMemory(ctx->device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+    return memory;
+}
+
+bool MemoryAllocator::allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation)
+{
+    auto best = block.free_ranges.end();
+    for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); it++) {
+        VkDeviceSize aligned = (it->first + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+        if (aligned + requirements.size > it->first + it->second)
+            continue;
+        if (best == block.free_ranges.end() || it->second < best->second)
+            best = it;
+    }
+    if (best == block.free_ranges.end())
+        return false;
+
+    VkDeviceSize offset  = best->first;
+    VkDeviceSize end     = best->first + best->second;
+    VkDeviceSize aligned = (offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+    block.free_ranges.erase(best);
+    if (aligned > offset)
+        block.free_ranges[offset] = aligned - offset;
+    if (aligned + requirements.size < end)
+        block.free_ranges[aligned + requirements.size] = end - aligned - requirements.size;
+
+    block.allocations++;
+    block.used += requirements.size;
+    allocation.memory = block.memory;
+    allocation.offset = aligned;
+    allocation.size   = requirements.size;
+    allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + aligned : nullptr;
+    return true;
+}
+
+Allocation MemoryAllocator::allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties,
+    bool linear,
+    bool dedicated,
+    const void* pNext)
+{
+    uint32_t type = findMemoryType(*ctx, requirements.memoryTypeBits, properties);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Allocation allocation;
+    allocation.pool = poolIndex(type, linear);
+
+    if (dedicated || pNext != nullptr || requirements.size > block_sizes[type] / 2) {
+        allocation.memory = allocateMemory(requirements.size, type, pNext, &allocation.mapped);
+        allocation.size   = requirements.size;
+        allocation.block  = Allocation::DEDICATED;
+        dedicated_count++;
+        dedicated_bytes += requirements.size;
+    } else {
+        auto& pool = pools[allocation.pool];
+        uint32_t i = 0;
+        for (; i < pool.blocks.size(); i++) {
+            if (pool.blocks[i].memory != VK_NULL_HANDLE && allocateFromBlock(pool.blocks[i], requirements, allocation))
+                break;
+        }
+        if (i == pool.blocks.size()) {
+            for (i = 0; i < pool.blocks.size(); i++) {
+                if (pool.blocks[i].memory == VK_NULL_HANDLE)
+                    break;
+            }
+            if (i == pool.blocks.size())
+                pool.blocks.emplace_back();
+
+            auto& block  = pool.blocks[i];
+            block.size   = block_sizes[type];
+            block.memory = allocateMemory(block.size, type, nullptr, &block.mapped);
+            block.free_ranges.clear();
+            block.free_ranges[0] = block.size;
+            allocateFromBlock(block, requirements, allocation);
+        }
+        allocation.block = i;
+    }
+
+    peak_device_allocations = std::max(peak_device_allocations, collect().device_allocations);
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (allocation.block == Allocation::DEDICATED) {
+        if (allocation.mapped != nullptr)
+            vkUnmapMemory(ctx->device, allocation.memory);
+        vkFreeMemory(ctx->device, allocation.memory, nullptr);
+        dedicated_count--;
+        dedicated_bytes -= allocation.size;
+        allocation = Allocation {};
+        return;
+    }
+
+    auto& pool  = pools[allocation.pool];
+    auto& block = pool.blocks[allocation.block];
+    assert(block.memory == allocation.memory);
+
+    // merge with the free neighbours
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size   = allocation.size;
+    auto next           = block.free_ranges.lower_bound(offset);
+    if (next != block.free_ranges.end() && next->first == offset + size) {
+        size += next->second;
+        next = block.free_ranges.erase(next);
+    }
+    if (next != block.free_ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            block.free_ranges.erase(prev);
+        }
+    }
+    block.free_ranges[offset] = size;
+    block.allocations--;
+    block.used -= allocation.size;
+
+    // an empty block is kept only if it's the last one of its pool, so freeing and allocating again doesn't thrash
+    if (block.allocations == 0) {
+        uint32_t live = 0;
+        for (const auto& b : pool.blocks) {
+            if (b.memory != VK_NULL_HANDLE)
+                live++;
+        }
+        if (live > 1) {
+            if (block.mapped != nullptr)
+                vkUnmapMemory(ctx->device, block.memory);
+            vkFreeMemory(ctx->device, block.memory, nullptr);
+            block = Block {};
+        }
+    }
+    allocation = Allocation {};
+}
+
+MemoryStats MemoryAllocator::collect() const
+{
+    MemoryStats s;
+    for (const auto& pool : pools) {
+        for (const auto& block : pool.blocks) {
+            if (block.memory == VK_NULL_HANDLE)
+                continue;
+            s.blocks++;
+            s.block_bytes += block.size;
+            s.allocations += block.allocations;
+            s.used_bytes += block.used;
+        }
+    }
+    s.dedicated               = dedicated_count;
+    s.dedicated_bytes         = dedicated_bytes;
+    s.device_allocations      = s.blocks + s.dedicated;
+    s.peak_device_allocations = std::max(peak_device_allocations, s.device_allocations);
+    return s;
+}
+
+MemoryStats MemoryAllocator::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return collect();
+}
+
+void MemoryAllocator::report()
+{
+    auto s = stats();
+    INFO_ALL("memory allocator: "
+             + std::to_string(s.allocations) + " allocations using " + std::to_string(s.used_bytes >> 20) + " MB of "
+             + std::to_string(s.blocks) + " blocks (" + std::to_string(s.block_bytes >> 20) + " MB), "
+             + std::to_string(s.dedicated) + " dedicated (" + std::to_string(s.dedicated_bytes >> 20) + " MB), "
+             + std::to_string(s.device_allocations) + " device allocations, peak "
+             + std::to_string(s.peak_device_allocations) + " of "
+             + std::to_string(max_allocations));
+}
+}
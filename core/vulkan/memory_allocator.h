@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Vk {
+struct Context;
+
+// A range of a VkDeviceMemory. memory is VK_NULL_HANDLE if nothing is allocated
+struct Allocation {
+    static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    void* mapped          = nullptr; // host visible memory stays mapped
+    uint32_t pool         = 0;
+    uint32_t block        = DEDICATED;
+};
+
+struct MemoryStats {
+    uint32_t blocks                  = 0;
+    VkDeviceSize block_bytes         = 0;
+    uint32_t allocations             = 0; // sub-allocated from the blocks
+    VkDeviceSize used_bytes          = 0;
+    uint32_t dedicated               = 0;
+    VkDeviceSize dedicated_bytes     = 0;
+    uint32_t device_allocations      = 0; // live VkDeviceMemory, blocks and dedicated
+    uint32_t peak_device_allocations = 0;
+};
+
+// Sub-allocates device memory from large blocks instead of one vkAllocateMemory per resource.
+// A pool holds the blocks of one memory type, for either linear resources (buffers, linear images)
+// or optimal images, so bufferImageGranularity never applies between neighbours.
+// The free ranges of a block are sorted by offset, best fit, and merged with their neighbours on free.
+// Large resources, the ones the driver prefers dedicated and exported memory get their own allocation.
+class MemoryAllocator {
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE; // VK_NULL_HANDLE: released, the slot is reused
+        VkDeviceSize size     = 0;
+        void* mapped          = nullptr;
+        std::map<VkDeviceSize, VkDeviceSize> free_ranges; // offset to size
+        uint32_t allocations = 0;
+        VkDeviceSize used    = 0;
+    };
+
+    struct Pool {
+        std::vector<Block> blocks;
+    };
+
+    VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t type, const void* pNext, void** mapped);
+    bool allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation);
+    uint32_t poolIndex(uint32_t type, bool linear) const { return type * 2 + (linear ? 1 : 0); }
+    MemoryStats collect() const; // the mutex is locked
+
+    const Context* ctx;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    uint32_t max_allocations = 0; // maxMemoryAllocationCount
+    std::vector<Pool> pools;
+    std::vector<VkDeviceSize> block_sizes; // per memory type
+    std::mutex mutex;
+
+    uint32_t dedicated_count         = 0;
+    VkDeviceSize dedicated_bytes     = 0;
+    uint32_t peak_device_allocations = 0;
+
+    static constexpr VkDeviceSize BLOCK_SIZE = 64 << 20;
+
+public:
+    void init(const Context* ctx);
+    // every allocation should be freed before
+    void cleanup();
+
+    // linear: a buffer or a linear image. pNext is chained to VkMemoryAllocateInfo, only for dedicated ones
+    Allocation allocate(
+        const VkMemoryRequirements& requirements,
+        VkMemoryPropertyFlags properties,
+        bool linear,
+        bool dedicated    = false,
+        const void* pNext = nullptr);
+    void free(Allocation& allocation);
+
+    MemoryStats stats();
+    // logs the stats
+    void report();
+};
+}
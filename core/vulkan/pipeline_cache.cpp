@@ -0,0 +1,182 @@
+#include "pipeline_cache.h"
+#include "core/tool/logger.h"
+#include "core/vulkan/vulkan_context.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace Vk {
+
+void PipelineCache::init(const Context* ctx, const std::filesystem::path& path)
+{
+    this->ctx  = ctx;
+    this->path = path;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &properties);
+    auto data = load(properties);
+
+    VkPipelineCacheCreateInfo createInfo {};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(ctx->device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+void PipelineCache::cleanup()
+{
+    if (cache == VK_NULL_HANDLE)
+        return;
+    save();
+    vkDestroyPipelineCache(ctx->device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
+
+std::vector<char> PipelineCache::load(const VkPhysicalDeviceProperties& properties)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        INFO_ALL("pipeline cache: no " + path.string() + ", starting empty");
+        return {};
+    }
+
+    FileHeader header {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file
+        || header.magic != MAGIC
+        || header.version != VERSION
+        || header.vendor_id != properties.vendorID
+        || header.device_id != properties.deviceID
+        || header.driver_version != properties.driverVersion
+        || memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        INFO_ALL("pipeline cache: " + path.string() + " is from another device or driver, starting empty");
+        return {};
+    }
+
+    // the size in a corrupt header could be anything, the data must fill the rest of the file
+    std::error_code ec;
+    auto file_size = std::filesystem::file_size(path, ec);
+    if (ec || header.data_size != file_size - sizeof(header)) {
+        WARN_ALL("pipeline cache: " + path.string() + " is truncated or corrupt, starting empty");
+        return {};
+    }
+
+    std::vector<char> data(header.data_size);
+    file.read(data.data(), data.size());
+    if (!file) {
+        WARN_ALL("pipeline cache: " + path.string() + " is truncated, starting empty");
+        return {};
+    }
+    return data;
+}
+
+void PipelineCache::save()
+{
+    size_t size = 0;
+    vkGetPipelineCacheData(ctx->device, cache, &size, nullptr);
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(ctx->device, cache, &size, data.data()) != VK_SUCCESS) {
+        WARN_ALL("pipeline cache: failed to get the cache data");
+        return;
+    }
+    data.resize(size);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &properties);
+    FileHeader header {};
+    header.magic          = MAGIC;
+    header.version        = VERSION;
+    header.vendor_id      = properties.vendorID;
+    header.device_id      = properties.deviceID;
+    header.driver_version = properties.driverVersion;
+    header.data_size      = data.size();
+    memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // another instance may be reading it, so the file is replaced in one step
+    // a failed write must not replace a good cache, and other instances may save at the same time
+    std::filesystem::path temporary;
+    try {
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path());
+        temporary = path;
+        temporary += "." + std::to_string(std::random_device {}()) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data.data(), data.size());
+            file.close();
+            if (!file.good())
+                throw std::runtime_error("failed to write " + temporary.string());
+        }
+        std::filesystem::rename(temporary, path);
+    } catch (const std::exception& e) {
+        WARN_ALL(std::string("pipeline cache: failed to write ") + path.string() + ": " + e.what());
+        std::error_code ec;
+        if (!temporary.empty())
+            std::filesystem::remove(temporary, ec);
+        return;
+    }
+    INFO_ALL("pipeline cache: wrote " + std::to_string(data.size() / 1024) + " KB to " + path.string());
+}
+
+template <typename Info, typename Create>
+VkPipeline PipelineCache::create(const Info& info, const std::string& name, Create vkCreate)
+{
+    Info createInfo = info;
+    VkPipelineCreationFeedbackEXT feedback {};
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo {};
+    if (ctx->pipelineCreationFeedback) {
+        feedbackInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedbackInfo.pNext                     = createInfo.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        createInfo.pNext                       = &feedbackInfo;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline pipeline;
+    if (vkCreate(ctx->device, cache, 1, &createInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline " + name + "!");
+    }
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::string result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats* stats = &unknown;
+        if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) != 0) {
+            bool hit = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+            stats    = hit ? &hits : &misses;
+            result   = hit ? " (cache hit)" : " (cache miss)";
+        }
+        stats->count++;
+        stats->ms += ms;
+    }
+    DEBUG_ALL("pipeline " + name + " created in " + std::to_string(ms) + "ms" + result);
+    return pipeline;
+}
+
+VkPipeline PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, const std::string& name)
+{
+    return create(info, name, vkCreateGraphicsPipelines);
+}
+
+VkPipeline PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo& info, const std::string& name)
+{
+    return create(info, name, vkCreateComputePipelines);
+}
+
+void PipelineCache::report()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string message = "pipeline cache: "
+        + std::to_string(hits.count) + " hits in " + std::to_string(hits.ms) + "ms, "
+        + std::to_string(misses.count) + " misses in " + std::to_string(misses.ms) + "ms";
+    if (unknown.count != 0) {
+        message += ", " + std::to_string(unknown.count) + " without creation feedback in " + std::to_string(unknown.ms) + "ms";
+    }
+    INFO_ALL(message);
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Vk {
+struct Context;
+
+// VkPipelineCache kept on disk between runs.
+// The file is only used if it was written by the same device (pipelineCacheUUID) and driver version.
+class PipelineCache {
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+    };
+
+    struct Stats {
+        uint32_t count = 0;
+        float ms       = 0.0f;
+    };
+
+    std::vector<char> load(const VkPhysicalDeviceProperties& properties);
+    void save();
+    // with the creation feedback chained, counted in the stats
+    template <typename Info, typename Create>
+    VkPipeline create(const Info& info, const std::string& name, Create vkCreate);
+
+    const Context* ctx;
+    std::filesystem::path path;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+
+    std::mutex mutex;
+    Stats hits, misses, unknown; // unknown: no VK_EXT_pipeline_creation_feedback
+
+    static constexpr uint32_t MAGIC   = 0x52454350; // "PCER"
+    static constexpr uint32_t VERSION = 1;
+
+public:
+    void init(const Context* ctx, const std::filesystem::path& path);
+    // writes the cache back to the file
+    void cleanup();
+
+    // thread safe, the pipeline cache is internally synchronized
+    VkPipeline createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, const std::string& name);
+    VkPipeline createComputePipeline(const VkComputePipelineCreateInfo& info, const std::string& name);
+    // logs the hits and misses so far
+    void report();
+};
+}
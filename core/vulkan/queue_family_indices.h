@@ -9,6 +9,8 @@ namespace Vk {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // a transfer only family (the DMA engines) if there is one, otherwise one without graphics, otherwise graphicsFamily
+    std::optional<uint32_t> transferFamily;
 
     static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
     {
@@ -26,13 +28,24 @@ struct QueueFamilyIndices {
 
             // if it can render to the surface we created
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (surface != VK_NULL_HANDLE)
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
             if (presentSupport) {
                 indices.presentFamily = i;
             }
 
             i++;
         }
+
+        for (i = 0; i < static_cast<int>(queueFamilies.size()); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0)
+                continue;
+            if (!indices.transferFamily.has_value() || (flags & VK_QUEUE_COMPUTE_BIT) == 0)
+                indices.transferFamily = i;
+        }
+        if (!indices.transferFamily.has_value())
+            indices.transferFamily = indices.graphicsFamily;
         return indices;
     }
 
@@ -0,0 +1,364 @@
+#include "staging_ring.h"
+#include "core/tool/logger.h"
+#include "core/vulkan/type/buffer.h"
+#include "core/vulkan/type/image.h"
+#include "core/vulkan/vulkan_context.h"
+#include "core/vulkan/vulkan_util.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace Vk {
+
+void StagingRing::init(const Context* ctx, size_t size)
+{
+    this->ctx  = ctx;
+    this->size = size / ALIGNMENT * ALIGNMENT;
+    createBuffer(
+        *ctx,
+        this->size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        buffer, allocation);
+    mapped = static_cast<char*>(allocation.mapped);
+
+    // the batches are reset one by one
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = ctx->queueFamilyIndices.graphicsFamily.value();
+    if (vkCreateCommandPool(ctx->device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
+    }
+}
+
+void StagingRing::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submit();
+        while (retire(true)) { }
+    }
+    INFO_ALL("staging ring: " + std::to_string(stats.bytes >> 20) + "MB uploaded in "
+             + std::to_string(stats.submissions) + " submissions, "
+             + std::to_string(stats.stalls) + " stalls");
+
+    for (auto& batch : batches) {
+        vkDestroyFence(ctx->device, batch.fence, nullptr);
+    }
+    batches.clear();
+    free_batches.clear();
+    vkDestroyCommandPool(ctx->device, pool, nullptr);
+
+    vkDestroyBuffer(ctx->device, buffer, nullptr);
+    ctx->allocator.free(allocation);
+}
+
+uint64_t StagingRing::allocate(size_t size, size_t alignment)
+{
+    assert(size <= this->size);
+
+    while (retire(false)) { }
+    while (true) {
+        if (tail == head && recording < 0) {
+            // empty, start over from the beginning of the buffer
+            tail = head = (head + this->size - 1) / this->size * this->size;
+        }
+
+        uint64_t position = head;
+        size_t offset     = position % this->size;
+        size_t aligned    = (offset + alignment - 1) / alignment * alignment;
+        position += aligned - offset;
+        if (aligned + size > this->size) {
+            // doesn't fit before the end of the buffer
+            position += this->size - aligned;
+        }
+        if (position + size - tail <= this->size) {
+            head = position + size;
+            return position;
+        }
+
+        // the open batch holds the space, it has to be submitted first
+        if (in_flight.empty())
+            submit();
+        stats.stalls++;
+        retire(true);
+    }
+}
+
+VkCommandBuffer StagingRing::open()
+{
+    if (recording >= 0)
+        return batches[recording].commandBuffer;
+
+    if (free_batches.empty()) {
+        if (batches.size() < MAX_BATCHES) {
+            Batch batch;
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool        = pool;
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(ctx->device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffers!");
+            }
+            VkFenceCreateInfo fenceInfo {};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(ctx->device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create fence!");
+            }
+            free_batches.emplace_back(static_cast<uint32_t>(batches.size()));
+            batches.emplace_back(batch);
+        } else {
+            stats.stalls++;
+            retire(true);
+        }
+    }
+    recording = static_cast<int32_t>(free_batches.back());
+    free_batches.pop_back();
+
+    auto commandBuffer = batches[recording].commandBuffer;
+    vkResetCommandBuffer(commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    // frames submitted before may still read the destinations
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr);
+    return commandBuffer;
+}
+
+void StagingRing::submit()
+{
+    if (recording < 0)
+        return;
+
+    auto& batch = batches[recording];
+    VkMemoryBarrier barrier {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        batch.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    std::vector<VkPipelineStageFlags> wait_stages(wait_semaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(wait_values.size());
+    timelineInfo.pWaitSemaphoreValues      = wait_values.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size());
+    timelineInfo.pSignalSemaphoreValues    = signal_values.data();
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = static_cast<uint32_t>(wait_semaphores.size());
+    submitInfo.pWaitSemaphores      = wait_semaphores.data();
+    submitInfo.pWaitDstStageMask    = wait_stages.data();
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+    submitInfo.pSignalSemaphores    = signal_semaphores.data();
+    if (vkQueueSubmit(ctx->queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    wait_semaphores.clear();
+    wait_values.clear();
+    signal_semaphores.clear();
+    signal_values.clear();
+
+    batch.end = head;
+    in_flight.emplace_back(static_cast<uint32_t>(recording));
+    recording = -1;
+    written.clear();
+    stats.submissions++;
+}
+
+bool StagingRing::retire(bool wait)
+{
+    if (in_flight.empty())
+        return false;
+
+    auto& batch = batches[in_flight.front()];
+    if (wait) {
+        vkWaitForFences(ctx->device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    } else if (vkGetFenceStatus(ctx->device, batch.fence) != VK_SUCCESS) {
+        return false;
+    }
+    vkResetFences(ctx->device, 1, &batch.fence);
+    // the batches complete in submission order on the queue
+    tail = batch.end;
+    free_batches.emplace_back(in_flight.front());
+    in_flight.pop_front();
+    return true;
+}
+
+void StagingRing::upload(const Buffer& dst, const void* data, size_t size, size_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (std::find(written.begin(), written.end(), dst.buffer) != written.end()) {
+        VkMemoryBarrier barrier {};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            open(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+        written.clear();
+    }
+
+    const char* src  = static_cast<const char*>(data);
+    size_t max_chunk = this->size / 2;
+    for (size_t done = 0; done < size;) {
+        size_t chunk      = std::min(size - done, max_chunk);
+        uint64_t position = allocate(chunk, ALIGNMENT);
+        memcpy(mapped + position % this->size, src + done, chunk);
+        copyBuffer(open(), buffer, dst.buffer, chunk, position % this->size, offset + done);
+        done += chunk;
+    }
+    written.emplace_back(dst.buffer);
+    stats.bytes += size;
+}
+
+void StagingRing::upload(Image& dst, const void* data, uint32_t mipLevel)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    VkExtent3D extent = {
+        std::max(1u, dst.extent.width >> mipLevel),
+        std::max(1u, dst.extent.height >> mipLevel),
+        std::max(1u, dst.extent.depth >> mipLevel),
+    };
+    size_t texel     = formatSize(dst.format);
+    size_t row       = extent.width * texel;
+    size_t slice     = row * extent.height;
+    size_t alignment = std::lcm(texel, ALIGNMENT); // buffer offsets of image copies are multiples of the texel size
+    size_t max_chunk = this->size / 2;
+    if (row > max_chunk)
+        throw std::runtime_error("staging ring: a row of the image is larger than half of the ring");
+
+    VkImageLayout final_layout = dst.layout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : dst.layout;
+    transitionImageLayout(open(), dst.image, dst.format, dst.layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // whole slices if they fit, rows of one slice otherwise
+    const char* src = static_cast<const char*>(data);
+    if (slice <= max_chunk) {
+        uint32_t slices = static_cast<uint32_t>(max_chunk / slice);
+        for (uint32_t z = 0; z < extent.depth; z += slices) {
+            uint32_t depth = std::min(slices, extent.depth - z);
+            copyToImage(dst, src + z * slice, depth * slice, alignment,
+                        { 0, 0, static_cast<int32_t>(z) },
+                        { extent.width, extent.height, depth },
+                        mipLevel);
+        }
+    } else {
+        uint32_t rows = static_cast<uint32_t>(max_chunk / row);
+        for (uint32_t z = 0; z < extent.depth; z++) {
+            for (uint32_t y = 0; y < extent.height; y += rows) {
+                uint32_t height = std::min(rows, extent.height - y);
+                copyToImage(dst, src + z * slice + y * row, height * row, alignment,
+                            { 0, static_cast<int32_t>(y), static_cast<int32_t>(z) },
+                            { extent.width, height, 1 },
+                            mipLevel);
+            }
+        }
+    }
+
+    transitionImageLayout(open(), dst.image, dst.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout);
+    dst.layout = final_layout;
+    stats.bytes += slice * extent.depth;
+}
+
+void StagingRing::copyToImage(Image& dst, const char* data, size_t size, size_t alignment,
+                              const VkOffset3D& offset, const VkExtent3D& extent, uint32_t mipLevel)
+{
+    uint64_t position = allocate(size, alignment);
+    memcpy(mapped + position % this->size, data, size);
+
+    VkBufferImageCopy region {};
+    region.bufferOffset                    = position % this->size;
+    region.bufferRowLength                 = 0; // Tightly packed
+    region.bufferImageHeight               = 0; // Tightly packed
+    region.imageSubresource.aspectMask     = dst.format == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = mipLevel;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset                     = offset;
+    region.imageExtent                     = extent;
+    vkCmdCopyBufferToImage(open(), buffer, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void StagingRing::execute(const std::function<void(VkCommandBuffer)>& fn)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fn(open());
+    submit();
+    while (retire(true)) { }
+}
+
+void StagingRing::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    submit();
+}
+
+void StagingRing::record(const std::function<void(VkCommandBuffer)>& fn)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fn(open());
+}
+
+void StagingRing::wait(VkSemaphore semaphore, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    open();
+    auto it = std::find(wait_semaphores.begin(), wait_semaphores.end(), semaphore);
+    if (it != wait_semaphores.end()) {
+        auto& v = wait_values[it - wait_semaphores.begin()];
+        v       = std::max(v, value);
+        return;
+    }
+    wait_semaphores.emplace_back(semaphore);
+    wait_values.emplace_back(value);
+}
+
+void StagingRing::signal(VkSemaphore semaphore, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    open();
+    auto it = std::find(signal_semaphores.begin(), signal_semaphores.end(), semaphore);
+    if (it != signal_semaphores.end()) {
+        auto& v = signal_values[it - signal_semaphores.begin()];
+        v       = std::max(v, value);
+        return;
+    }
+    signal_semaphores.emplace_back(semaphore);
+    signal_values.emplace_back(value);
+}
+}
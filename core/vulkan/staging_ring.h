@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "core/vulkan/memory_allocator.h"
+#include <vulkan/vulkan.h>
+
+namespace Vk {
+struct Context;
+struct Buffer;
+struct Image;
+
+// One persistently mapped staging buffer used as a ring by all the uploads.
+// The copies are recorded into the open batch, which is submitted on the graphics queue with a fence
+// before the next frame, when the ring is full, or by execute(). Space is reused once its batch's fence
+// is signaled, nothing waits for the queue to be idle.
+class StagingRing {
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence                 = VK_NULL_HANDLE;
+        uint64_t end                  = 0; // ring position after the last allocation of the batch
+    };
+
+    struct Stats {
+        uint64_t bytes       = 0;
+        uint32_t submissions = 0;
+        uint32_t stalls      = 0; // waits for the gpu to free space or a batch
+    };
+
+    // positions grow monotonically, the offset in the buffer is position % size.
+    // May submit the open batch to make space
+    uint64_t allocate(size_t size, size_t alignment);
+    VkCommandBuffer open();
+    void submit();
+    // the oldest submitted batch, only if its fence is signaled unless wait
+    bool retire(bool wait);
+    void copyToImage(Image& dst, const char* data, size_t size, size_t alignment,
+                     const VkOffset3D& offset, const VkExtent3D& extent, uint32_t mipLevel);
+
+    // the batch writes to these buffers already, a second copy needs a barrier before it
+    std::vector<VkBuffer> written;
+    // timeline semaphore values the open batch waits for and signals
+    std::vector<VkSemaphore> wait_semaphores, signal_semaphores;
+    std::vector<uint64_t> wait_values, signal_values;
+
+    const Context* ctx;
+    VkBuffer buffer    = VK_NULL_HANDLE;
+    Allocation allocation;
+    char* mapped       = nullptr;
+    size_t size        = 0;
+    VkCommandPool pool = VK_NULL_HANDLE;
+
+    std::vector<Batch> batches;
+    std::vector<uint32_t> free_batches;
+    std::deque<uint32_t> in_flight; // submitted, oldest first
+    int32_t recording = -1; // the open batch
+    uint64_t head     = 0; // next free position
+    uint64_t tail     = 0; // oldest position the gpu may still read
+
+    std::mutex mutex;
+    Stats stats;
+
+    static constexpr size_t ALIGNMENT     = 16;
+    static constexpr uint32_t MAX_BATCHES = 8;
+
+public:
+    void init(const Context* ctx, size_t size);
+    // waits for the pending batches
+    void cleanup();
+
+    void upload(const Buffer& dst, const void* data, size_t size, size_t offset);
+    // the whole mip level, the image is left in its layout, or TRANSFER_DST if it was UNDEFINED
+    void upload(Image& dst, const void* data, uint32_t mipLevel);
+    // records fn after the uploads so far, submits and waits for it
+    void execute(const std::function<void(VkCommandBuffer)>& fn);
+    // submits the open batch without waiting, the later submissions on the graphics queue see the data
+    void flush();
+
+    // records fn into the open batch after the uploads so far, without submitting it
+    void record(const std::function<void(VkCommandBuffer)>& fn);
+    // the open batch waits for the timeline semaphore to reach value before it starts
+    void wait(VkSemaphore semaphore, uint64_t value);
+    // the open batch sets the timeline semaphore to value once it's done
+    void signal(VkSemaphore semaphore, uint64_t value);
+};
+}
@@ -18,10 +18,10 @@ Buffer Buffer::New(const Vk::Context& ctx,
     Buffer b;
     b.CreateUUID();
     b.size = size;
-    createBuffer(ctx, size, usage, properties, b.buffer, b.memory, external);
-    b.mapped = nullptr;
-    if (cpu_mapped)
-        vkMapMemory(ctx.device, b.memory, 0, size, 0, &b.mapped);
+    createBuffer(ctx, size, usage, properties, b.buffer, b.allocation, external);
+    // host visible memory stays mapped by the allocator
+    b.mapped = cpu_mapped ? b.allocation.mapped : nullptr;
+    assert(!cpu_mapped || b.mapped != nullptr);
     b.usage = usage;
     return b;
 }
@@ -46,23 +46,18 @@ void Buffer::Update(const Context& ctx, const void* data, size_t size, size_t of
         throw std::runtime_error("buffer must be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT");
     }
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    createBuffer(
-        ctx,
-        size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory, true);
-    void* mapped_data;
-    vkMapMemory(ctx.device, staging_buffer_memory, 0, size, 0, &mapped_data);
-    memcpy(mapped_data, data, size);
-    vkUnmapMemory(ctx.device, staging_buffer_memory);
-
-    copyBufferSingleTime(ctx, staging_buffer, buffer, size, 0, offset);
-
-    vkDestroyBuffer(ctx.device, staging_buffer, nullptr);
-    vkFreeMemory(ctx.device, staging_buffer_memory, nullptr);
+    ctx.staging.upload(*this, data, size, offset);
+}
+
+UploadTicket Buffer::UpdateAsync(const Context& ctx, const void* data, size_t size, size_t offset,
+                                 const std::function<void(VkCommandBuffer)>& then)
+{
+    return ctx.transfer.upload(*this, data, size, offset, then);
+}
+
+void Buffer::UpdateDeferred(Context& ctx, const void* data, size_t size, size_t offset)
+{
+    ctx.uploader.push(*this, data, size, offset);
 }
 
 void Buffer::CopyToSingleTime(
@@ -144,5 +139,5 @@ void Buffer::CopyTo(
 void Buffer::Delete(const Context& ctx, Buffer& b)
 {
     vkDestroyBuffer(ctx.device, b.buffer, nullptr);
-    vkFreeMemory(ctx.device, b.memory, nullptr);
+    ctx.allocator.free(b.allocation);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "core/tool/uuid.h"
+#include "core/vulkan/async_uploader.h"
+#include "core/vulkan/memory_allocator.h"
 #include <vulkan/vulkan_core.h>
 
 namespace Vk {
@@ -19,7 +21,14 @@ struct Buffer {
                       bool external   = false);
     static void Delete(const Vk::Context& ctx, Buffer& b);
     void CreateUUID();
+    // memcpy if mapped, otherwise copied through the staging ring, submitted before the next frame
     void Update(const Context& ctx, const void* data, size_t size, size_t offset = 0);
+    // on the transfer queue, the range must not be used by the gpu until the ticket is ready.
+    // then is recorded on the graphics queue once the data is there
+    UploadTicket UpdateAsync(const Context& ctx, const void* data, size_t size, size_t offset = 0,
+                             const std::function<void(VkCommandBuffer)>& then = {});
+    // Applied at the beginning of the next recorded frame, so frames in flight are not affected
+    void UpdateDeferred(Context& ctx, const void* data, size_t size, size_t offset = 0);
     void CopyTo(
         const Context& ctx,
         Buffer& dst,
@@ -51,7 +60,7 @@ struct Buffer {
 
     uuid::UUID id = uuid::nil_uuid();
     VkBuffer buffer;
-    VkDeviceMemory memory;
+    Allocation allocation; // dedicated if external
     void* mapped = nullptr;
     VkBufferUsageFlags usage;
     size_t size = 0;
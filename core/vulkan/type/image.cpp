@@ -21,7 +21,7 @@ Image Image::New(const Context& ctx,
 {
     Image i;
     i.CreateUUID();
-    i.size    = createImage(ctx, extent, format, usage, properties, i.image, i.memory, external, tiling, imageType, mipLevels);
+    i.size    = createImage(ctx, extent, format, usage, properties, i.image, i.allocation, external, tiling, imageType, mipLevels);
     i.view    = createImageView(ctx, i.image, format, aspectFlags, viewType, mipLevels);
     i.format  = format;
     i.extent  = extent;
@@ -84,26 +84,12 @@ void Image::AddSampler(const Context& ctx, const VkFilter filter, const std::vec
 
 void Image::Update(const Context& ctx, const void* data, uint32_t mipLevel)
 {
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    createBuffer(
-        ctx,
-        size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory, true);
-    void* mapped_data;
-    vkMapMemory(ctx.device, staging_buffer_memory, 0, size, 0, &mapped_data);
-    memcpy(mapped_data, data, size);
-    vkUnmapMemory(ctx.device, staging_buffer_memory);
-
-    if (layout == VK_IMAGE_LAYOUT_UNDEFINED) {
-        TransitionLayoutSingleTime(ctx, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    }
-    copyBufferToImageSingleTime(ctx, staging_buffer, image, layout, format, extent, mipLevel);
+    ctx.staging.upload(*this, data, mipLevel);
+}
 
-    vkDestroyBuffer(ctx.device, staging_buffer, nullptr);
-    vkFreeMemory(ctx.device, staging_buffer_memory, nullptr);
+UploadTicket Image::UpdateAsync(const Context& ctx, const void* data, VkImageLayout newLayout)
+{
+    return ctx.transfer.upload(*this, data, newLayout);
 }
 
 void Image::CopyTo(
@@ -228,7 +214,7 @@ void Image::Delete(const Context& ctx, Image& i)
 {
     vkDestroyImageView(ctx.device, i.view, nullptr);
     vkDestroyImage(ctx.device, i.image, nullptr);
-    vkFreeMemory(ctx.device, i.memory, nullptr);
+    ctx.allocator.free(i.allocation);
     if (i.sampler != VK_NULL_HANDLE)
         vkDestroySampler(ctx.device, i.sampler, nullptr);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "core/tool/uuid.h"
+#include "core/vulkan/async_uploader.h"
+#include "core/vulkan/memory_allocator.h"
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
@@ -28,7 +30,10 @@ struct Image {
     void CreateUUID();
     void AddSampler(const Context& ctx, const VkFilter filter, const std::vector<VkSamplerAddressMode>& addressMode, const VkBorderColor borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK);
     void AddDefaultSampler(const Context& ctx);
+    // through the staging ring, submitted before the next frame or the next single time command
     void Update(const Context& ctx, const void* data, uint32_t mipLevel = 0);
+    // mip level 0 on the transfer queue, for images the gpu doesn't use until the ticket is ready
+    UploadTicket UpdateAsync(const Context& ctx, const void* data, VkImageLayout newLayout);
     void TransitionLayout(const Context& ctx, VkImageLayout newLayout);
     void TransitionLayoutSingleTime(const Context& ctx, VkImageLayout newLayout);
     void CopyTo(
@@ -67,7 +72,7 @@ struct Image {
     uuid::UUID id = uuid::nil_uuid();
     VkImage image;
     VkImageView view;
-    VkDeviceMemory memory;
+    Allocation allocation; // dedicated if external
     VkExtent3D extent;
     VkFormat format;
     VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
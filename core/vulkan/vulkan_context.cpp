@@ -5,6 +5,7 @@
 #include "core/vulkan/vulkan_util.h"
 #include <GLFW/glfw3.h>
 #include <set>
+#include <thread>
 #ifdef _WIN64
 #include <dxgi1_2.h>
 #endif
@@ -15,34 +16,67 @@ Context::~Context() = default;
 
 void Context::init(const Configuration& config, GLFWwindow* window)
 {
-    this->window = window;
+    this->window   = window;
+    this->headless = loadHeadless(config).enable;
+    WIDTH          = config["width"];
+    HEIGHT         = config["height"];
+    if (config.contains("frames_in_flight"))
+        MAX_FRAMES_IN_FLIGHT = std::max(1, config["frames_in_flight"].get<int>());
+    INIT_THREADS = std::min(4u, std::max(1u, std::thread::hardware_concurrency()) - 1);
+    if (config.contains("init_threads"))
+        INIT_THREADS = std::max(0, config["init_threads"].get<int>());
+    if (config.contains("staging_size"))
+        STAGING_SIZE = static_cast<size_t>(std::max(1, config["staging_size"].get<int>())) << 20;
 
     initVulkan();
+    uploader.init(this, MAX_FRAMES_IN_FLIGHT);
+
+    std::string pipeline_cache_path = config.at("render_graph").value("shader_directory", std::string(".")) + "/cache/pipeline_cache.bin";
+    if (config.contains("pipeline_cache"))
+        pipeline_cache_path = config["pipeline_cache"].get<std::string>();
+    pipelineCache.init(this, pipeline_cache_path);
 }
 
 void Context::cleanup()
 {
+    staging.cleanup();
+    transfer.cleanup();
+    uploader.cleanup();
+    pipelineCache.cleanup();
+
     vkDestroySemaphore(device, cuUpdateSemaphore, nullptr);
     vkDestroySemaphore(device, vkUpdateSemaphore, nullptr);
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
+    destroyRenderFinishedSemaphores();
 
-    vkDestroyCommandPool(device, commandPool, nullptr);
+    if (headless) {
+        cleanupOffscreenImages();
+    } else {
+        cleanupSwapChain();
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
 
-    cleanupSwapChain();
+    vkDestroyCommandPool(device, commandPool, nullptr);
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    allocator.cleanup();
     vkDestroyDevice(device, nullptr);
 #ifdef DEBUG
     debugMessager.destroy(*this);
 #endif
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+VkImageLayout Context::presentLayout() const
+{
+    return headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 }
 
 void Context::createInstance()
@@ -59,10 +93,13 @@ void Context::createInstance()
     appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
     appInfo.apiVersion         = VK_API_VERSION_1_2;
 
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
     for (const auto& e : instanceExtensions)
         extensions.push_back(e);
 
@@ -144,7 +181,8 @@ bool Context::checkDeviceExtensionSupport(VkPhysicalDevice device)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    auto extensions = requiredDeviceExtensions();
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -153,6 +191,21 @@ bool Context::checkDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool Context::isDeviceExtensionSupported(VkPhysicalDevice device, const char* name)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, name) == 0)
+            return true;
+    }
+    return false;
+}
+
 bool Context::isDeviceSuitable(VkPhysicalDevice device)
 {
     VkPhysicalDeviceProperties deviceProperties;
@@ -165,6 +218,16 @@ bool Context::isDeviceSuitable(VkPhysicalDevice device)
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
+    if (headless) {
+        // no surface to present to, and software drivers (lavapipe) are fine
+        if (!extensionsSupported)
+            WARN_CONSOLE("Some of the device extensions are not supported");
+        return deviceFeatures.geometryShader
+            && deviceFeatures.samplerAnisotropy
+            && indices.graphicsFamily.has_value()
+            && extensionsSupported;
+    }
+
     bool swapChainAdequate = false;
     if (extensionsSupported) {
         SwapChainSupport swapChainSupport = SwapChainSupport::querySwapChainSupport(device, surface);
@@ -206,21 +269,40 @@ void Context::pickPhysicalDevice()
 void Context::createLogicalDeviceAndQueue()
 {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = {
+        queueFamilyIndices.graphicsFamily.value(),
+        queueFamilyIndices.presentFamily.value(),
+        queueFamilyIndices.transferFamily.value(),
+    };
 
-    float queuePriority = 1.0f;
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // without a transfer family, the uploads use a second queue of the graphics family if it has one
+    uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+    uint32_t transferIndex  = 0;
+    if (queueFamilyIndices.transferFamily == queueFamilyIndices.graphicsFamily && queueFamilies[graphicsFamily].queueCount > 1)
+        transferIndex = 1;
+
+    float queuePriorities[] = { 1.0f, 0.5f };
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo {};
         queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount       = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount       = queueFamily == graphicsFamily ? transferIndex + 1 : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures {};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineSemaphoreFeatures.pNext = nullptr;
+
     VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures {};
     descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
-    descriptorIndexingFeatures.pNext = nullptr;
+    descriptorIndexingFeatures.pNext = &timelineSemaphoreFeatures;
 
     VkPhysicalDeviceFeatures2 deviceFeatures {};
     deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -232,14 +314,22 @@ void Context::createLogicalDeviceAndQueue()
     assert(descriptorIndexingFeatures.descriptorBindingUniformBufferUpdateAfterBind);
     assert(descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing);
     assert(descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind);
+    assert(timelineSemaphoreFeatures.timelineSemaphore);
+    // the object index of an indirect draw is its firstInstance
+    assert(deviceFeatures.features.drawIndirectFirstInstance);
+    multiDrawIndirect = deviceFeatures.features.multiDrawIndirect;
 
     VkDeviceCreateInfo createInfo {};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos       = queueCreateInfos.data();
     createInfo.pEnabledFeatures        = nullptr;
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    auto extensions                    = requiredDeviceExtensions();
+    pipelineCreationFeedback           = isDeviceExtensionSupported(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    if (pipelineCreationFeedback)
+        extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     createInfo.pNext                   = &deviceFeatures;
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device!");
@@ -247,6 +337,18 @@ void Context::createLogicalDeviceAndQueue()
 
     vkGetDeviceQueue(device, queueFamilyIndices.graphicsFamily.value(), 0, &queue);
     vkGetDeviceQueue(device, queueFamilyIndices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, queueFamilyIndices.transferFamily.value(), transferIndex, &transferQueue);
+}
+
+std::vector<const char*> Context::requiredDeviceExtensions() const
+{
+    std::vector<const char*> extensions;
+    for (const auto& e : deviceExtensions) {
+        if (headless && strcmp(e, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+            continue;
+        extensions.push_back(e);
+    }
+    return extensions;
 }
 
 void Context::createSurface()
@@ -346,7 +448,7 @@ void Context::createSwapChain()
         swapChainImage->size   = extent.width * extent.height * 4; // unorm
         swapChainImage->format = surfaceFormat.format;
         swapChainImage->extent = VkExtent3D { extent.width, extent.height, 1 };
-        swapChainImage->TransitionLayoutSingleTime(*this, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        swapChainImage->TransitionLayoutSingleTime(*this, presentLayout());
     }
 }
 
@@ -371,12 +473,44 @@ void Context::cleanupSwapChain()
     swapChainImages.clear();
 }
 
+void Context::createOffscreenImages()
+{
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        swapChainImages.emplace_back(std::make_unique<Image>(Image::New(
+            *this,
+            VK_FORMAT_B8G8R8A8_UNORM,
+            VkExtent3D { WIDTH, HEIGHT, 1 },
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+        swapChainImages.back()->TransitionLayoutSingleTime(*this, presentLayout());
+    }
+}
+
+void Context::cleanupOffscreenImages()
+{
+    for (auto& image : swapChainImages) {
+        Image::Delete(*this, *image);
+        image.reset(nullptr);
+    }
+    swapChainImages.clear();
+}
+
 void Context::recreateSwapChain()
 {
+    if (headless) // offscreen images have a fixed size
+        return;
+
+    size_t imageCount = swapChainImages.size();
     cleanupSwapChain();
 
     createSwapChain();
     createSwapChainImageViews();
+
+    if (swapChainImages.size() != imageCount) {
+        destroyRenderFinishedSemaphores();
+        createRenderFinishedSemaphores();
+    }
 }
 
 void Context::createCommandPoolAndBuffer()
@@ -395,9 +529,11 @@ void Context::createCommandPoolAndBuffer()
     allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     allocInfo.commandBufferCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
 
-    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers!");
     }
+    commandBuffer = commandBuffers[0];
 }
 
 void Context::initVulkan()
@@ -406,14 +542,31 @@ void Context::initVulkan()
 #ifdef DEBUG
     debugMessager.init(*this);
 #endif
-    createSurface();
-    pickPhysicalDevice();
-    queueFamilyIndices = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
-    createLogicalDeviceAndQueue();
-    createCommandPoolAndBuffer();
-
-    createSwapChain();
-    createSwapChainImageViews();
+    if (headless) {
+        surface = VK_NULL_HANDLE;
+        pickPhysicalDevice();
+        queueFamilyIndices               = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
+        queueFamilyIndices.presentFamily = queueFamilyIndices.graphicsFamily;
+        createLogicalDeviceAndQueue();
+        allocator.init(this);
+        createCommandPoolAndBuffer();
+        staging.init(this, STAGING_SIZE);
+        transfer.init(this);
+
+        createOffscreenImages();
+    } else {
+        createSurface();
+        pickPhysicalDevice();
+        queueFamilyIndices = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
+        createLogicalDeviceAndQueue();
+        allocator.init(this);
+        createCommandPoolAndBuffer();
+        staging.init(this, STAGING_SIZE);
+        transfer.init(this);
+
+        createSwapChain();
+        createSwapChainImageViews();
+    }
 
     createSyncObjects();
     createSyncObjectsExt();
@@ -422,7 +575,6 @@ void Context::initVulkan()
 void Context::createSyncObjects()
 {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkSemaphoreCreateInfo semaphoreInfo {};
@@ -433,10 +585,36 @@ void Context::createSyncObjects()
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS || vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS || vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS || vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
+
+    createRenderFinishedSemaphores();
+}
+
+// the presentation of an image may still wait on its semaphore when the next frame starts,
+// so these can't be reused per frame in flight
+void Context::createRenderFinishedSemaphores()
+{
+    renderFinishedSemaphores.resize(swapChainImages.size());
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < renderFinishedSemaphores.size(); i++) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+}
+
+void Context::destroyRenderFinishedSemaphores()
+{
+    for (auto& semaphore : renderFinishedSemaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    renderFinishedSemaphores.clear();
 }
 
 void Context::createSyncObjectsExt()
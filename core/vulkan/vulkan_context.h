@@ -1,8 +1,13 @@
 #pragma once
 
 #include "core/config/config.h"
+#include "core/vulkan/async_uploader.h"
 #include "core/vulkan/debug_messager.h"
+#include "core/vulkan/frame_uploader.h"
+#include "core/vulkan/memory_allocator.h"
+#include "core/vulkan/pipeline_cache.h"
 #include "core/vulkan/queue_family_indices.h"
+#include "core/vulkan/staging_ring.h"
 #include <vulkan/vulkan.h>
 #ifdef _WIN64
 // Don't define min() and max()
@@ -27,29 +32,46 @@ struct Context {
     void init(const Configuration& config, GLFWwindow* window);
     void recreateSwapChain();
     void cleanup();
+    // layout the render graph leaves the target image in at the end of a frame
+    VkImageLayout presentLayout() const;
 
+    bool headless = false;
     GLFWwindow* window;
     VkInstance instance;
     VkPhysicalDevice physicalDevice;
     VkDevice device;
     DebugMessager debugMessager;
+    mutable MemoryAllocator allocator; // createBuffer and createImage take a const Context
 
     VkCommandPool commandPool;
-    VkCommandBuffer commandBuffer;
+    std::vector<VkCommandBuffer> commandBuffers; // one per frame in flight, transfers the uploads of the frame
+    VkCommandBuffer commandBuffer; // the one being recorded, the render graph owns the frame's ones
+    FrameUploader uploader;
+    mutable StagingRing staging; // Buffer::Update and Image::Update take a const Context
+    mutable AsyncUploader transfer;
+    PipelineCache pipelineCache;
+    bool pipelineCreationFeedback = false; // VK_EXT_pipeline_creation_feedback is enabled
+    bool multiDrawIndirect        = false; // a vkCmdDrawIndexedIndirect can have more than one draw
 
     VkQueue queue;
     VkQueue presentQueue;
+    VkQueue transferQueue; // queue if there is no other one
     QueueFamilyIndices queueFamilyIndices;
 
     VkSurfaceKHR surface;
 
     VkSwapchainKHR swapChain;
+    // in headless mode these are offscreen images owned by the context
     std::vector<std::unique_ptr<Image>> swapChainImages;
 
     VkSemaphore cuUpdateSemaphore, vkUpdateSemaphore;
     std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
+    std::vector<VkSemaphore> renderFinishedSemaphores; // one per swapchain image
     std::vector<VkFence> inFlightFences;
+
+    uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    uint32_t INIT_THREADS         = 0; // 0 initializes the render graph nodes on the main thread
+    size_t STAGING_SIZE           = 64 << 20;
 #ifdef _WIN64
     HANDLE cuUpdateSemaphoreHandle;
     HANDLE vkUpdateSemaphoreHandle;
@@ -65,6 +87,7 @@ private:
 
     bool checkValidationLayerSupport();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* name);
     bool isDeviceSuitable(VkPhysicalDevice device);
     void pickPhysicalDevice();
     void createLogicalDeviceAndQueue();
@@ -76,16 +99,19 @@ private:
     void createSwapChain();
     void createSwapChainImageViews();
     void cleanupSwapChain();
+    void createOffscreenImages();
+    void cleanupOffscreenImages();
+    std::vector<const char*> requiredDeviceExtensions() const;
 
     void createCommandPoolAndBuffer();
 
     void createSyncObjects();
+    void createRenderFinishedSemaphores();
+    void destroyRenderFinishedSemaphores();
     void createSyncObjectsExt();
 
-    uint32_t WIDTH                 = 800;
-    uint32_t HEIGHT                = 600;
-    const int MAX_FRAMES_IN_FLIGHT = 1;
-    uint32_t currentFrame          = 0;
+    uint32_t WIDTH  = 800;
+    uint32_t HEIGHT = 600;
 
     const std::vector<const char*> instanceExtensions = {
 #ifdef DEBUG
@@ -1,5 +1,4 @@
 #include "core/vulkan/vulkan_util.h"
-#include "core/tool/sh.h"
 #include "core/vulkan/vulkan_context.h"
 #include <stdexcept>
 #include <string>
@@ -40,34 +39,8 @@ uint32_t findMemoryType(const Context& ctx, uint32_t typeFilter, VkMemoryPropert
 
 void singleTimeCommands(const Context& ctx, const std::function<void(const VkCommandBuffer&)>& fn)
 {
-    VkCommandBufferAllocateInfo allocInfo {};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool        = ctx.commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(ctx.device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    fn(commandBuffer);
-
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo {};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
-
-    vkQueueSubmit(ctx.queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(ctx.queue);
-
-    vkFreeCommandBuffers(ctx.device, ctx.commandPool, 1, &commandBuffer);
+    // after the uploads recorded so far, waits for its fence instead of the queue
+    ctx.staging.execute(fn);
 }
 
 VkDeviceSize createImage(
@@ -77,7 +50,7 @@ VkDeviceSize createImage(
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkImage& image,
-    VkDeviceMemory& imageMemory,
+    Allocation& allocation,
     bool external,
     const VkImageTiling tiling,
     const VkImageType imageType,
@@ -129,21 +102,24 @@ VkDeviceSize createImage(
     exportMemoryInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
 #endif
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(ctx.device, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo {};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(ctx, memRequirements.memoryTypeBits, properties);
-    if (external)
-        allocInfo.pNext = &exportMemoryInfo;
-
-    if (vkAllocateMemory(ctx.device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(ctx.device, image, imageMemory, 0);
+    VkMemoryDedicatedRequirements dedicatedRequirements {};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memRequirements2 {};
+    memRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memRequirements2.pNext = &dedicatedRequirements;
+    VkImageMemoryRequirementsInfo2 requirementsInfo {};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.image = image;
+    vkGetImageMemoryRequirements2(ctx.device, &requirementsInfo, &memRequirements2);
+    const auto& memRequirements = memRequirements2.memoryRequirements;
+
+    allocation = ctx.allocator.allocate(
+        memRequirements,
+        properties,
+        tiling == VK_IMAGE_TILING_LINEAR,
+        dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation,
+        external ? &exportMemoryInfo : nullptr);
+    vkBindImageMemory(ctx.device, image, allocation.memory, allocation.offset);
 
     return memRequirements.size;
 }
@@ -181,7 +157,7 @@ void createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory,
+    Allocation& allocation,
     bool external)
 {
     VkExternalMemoryBufferCreateInfo externalBufferInfo = {};
@@ -227,16 +203,8 @@ void createBuffer(
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(ctx.device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo {};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(ctx, memRequirements.memoryTypeBits, properties);
-    if (external)
-        allocInfo.pNext = &exportMemoryInfo;
-    if (vkAllocateMemory(ctx.device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
-    vkBindBufferMemory(ctx.device, buffer, bufferMemory, 0);
+    allocation = ctx.allocator.allocate(memRequirements, properties, true, false, external ? &exportMemoryInfo : nullptr);
+    vkBindBufferMemory(ctx.device, buffer, allocation.memory, allocation.offset);
 }
 
 void copyBufferSingleTime(
@@ -324,12 +292,13 @@ static std::unordered_map<VkImageLayout, LayoutDependency> layoutDependencies =
           VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT } },
 };
 
-void transitionImageLayout(
-    VkCommandBuffer commandBuffer,
+VkImageMemoryBarrier imageLayoutBarrier(
     VkImage image,
     VkFormat format,
     VkImageLayout oldLayout,
-    VkImageLayout newLayout)
+    VkImageLayout newLayout,
+    VkPipelineStageFlags& srcStage,
+    VkPipelineStageFlags& dstStage)
 {
     VkImageMemoryBarrier barrier {};
     barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -367,10 +336,25 @@ void transitionImageLayout(
         throw std::runtime_error("Unsupported new layout");
     barrier.srcAccessMask |= sourceDependency->second.access;
     barrier.dstAccessMask |= destinationDependency->second.access;
+    srcStage |= sourceDependency->second.stage;
+    dstStage |= destinationDependency->second.stage;
+    return barrier;
+}
+
+void transitionImageLayout(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    VkFormat format,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout)
+{
+    VkPipelineStageFlags srcStage = 0;
+    VkPipelineStageFlags dstStage = 0;
+    VkImageMemoryBarrier barrier  = imageLayoutBarrier(image, format, oldLayout, newLayout, srcStage, dstStage);
     vkCmdPipelineBarrier(
         commandBuffer,
-        sourceDependency->second.stage,
-        destinationDependency->second.stage,
+        srcStage,
+        dstStage,
         0,
         0, nullptr,
         0, nullptr,
@@ -601,6 +585,35 @@ VkShaderModule createShaderModule(const Context& ctx, const std::vector<char>& c
     return shaderModule;
 }
 
+uint32_t formatSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return 1;
+    case VK_FORMAT_R16_SFLOAT:
+        return 2;
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return 4;
+    case VK_FORMAT_R16G16B16_SFLOAT:
+        return 6;
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+        return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        throw std::runtime_error("unknown texel size of format " + std::to_string(format));
+    }
+}
+
 VkExtent3D toVkExtent3D(const VkExtent2D& extent)
 {
     return { extent.width, extent.height, 1 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/vulkan/memory_allocator.h"
 #include <cstdint>
 #include <filesystem>
 #include <functional>
@@ -38,7 +39,7 @@ void createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory,
+    Allocation& allocation,
     bool external = false);
 
 void copyBuffer(
@@ -63,7 +64,7 @@ VkDeviceSize createImage(
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkImage& image,
-    VkDeviceMemory& imageMemory,
+    Allocation& allocation,
     bool external               = false,
     const VkImageTiling tiling  = VK_IMAGE_TILING_OPTIMAL,
     const VkImageType imageType = VK_IMAGE_TYPE_2D,
@@ -76,6 +77,15 @@ VkImageView createImageView(
     VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
     const uint32_t mipLevels = 1);
 
+// fill a layout transition barrier and accumulate the stages it waits on/blocks,
+// so several of them can be submitted in one vkCmdPipelineBarrier
+VkImageMemoryBarrier imageLayoutBarrier(
+    VkImage image,
+    VkFormat format,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkPipelineStageFlags& srcStage,
+    VkPipelineStageFlags& dstStage);
 void transitionImageLayout(
     VkCommandBuffer commandBuffer,
     VkImage image,
@@ -158,6 +168,9 @@ void copyImageToImageSingleTime(
 
 VkShaderModule createShaderModule(const Vk::Context& ctx, const std::vector<char>& code);
 
+// bytes per texel of the uncompressed formats the engine uploads
+uint32_t formatSize(VkFormat format);
+
 VkExtent3D toVkExtent3D(const VkExtent2D& extent);
 VkExtent2D toVkExtent2D(const VkExtent3D& extent);
 
@@ -15,6 +15,7 @@ void Engine::init(Configuration& config,
     this->ui_engine      = ui_engine;
     this->physics_engine = physics_engine;
     this->scripts        = std::move(scripts);
+    headless_cfg         = loadHeadless(config);
 
     render_engine->init_core(config);
     window = render_engine->getGLFWWindow();
@@ -30,10 +31,15 @@ void Engine::init(Configuration& config,
     if (render_graph != nullptr) {
         INFO_ALL("Using custom render graph");
     }
-    render_engine->init_render(config, &g_ctx, ui_engine->getDrawUIFunction(), std::move(render_graph));
+    if (headless_cfg.enable) { // no window to draw the UI on
+        render_engine->init_render(config, &g_ctx, [](VkCommandBuffer) {}, std::move(render_graph));
+    } else {
+        render_engine->init_render(config, &g_ctx, ui_engine->getDrawUIFunction(), std::move(render_graph));
+    }
     physics_engine->init(config, &g_ctx);
 
-    ui_engine->init(config, render_engine->toUI()); // get renderpass from render graph
+    if (!headless_cfg.enable)
+        ui_engine->init(config, render_engine->toUI()); // get renderpass from render graph
 
     for (auto& script : this->scripts) {
         script->init(config);
@@ -50,16 +56,25 @@ void Engine::update_frame_time()
     currentTime = std::chrono::high_resolution_clock::now();
 }
 
+bool Engine::shouldClose()
+{
+    if (headless_cfg.enable)
+        return g_ctx.currentFrame >= static_cast<uint32_t>(headless_cfg.total_frame);
+    return glfwWindowShouldClose(window);
+}
+
 void Engine::run()
 {
-    while (!glfwWindowShouldClose(window)) {
+    while (!shouldClose()) {
         INFO_FILE("Engine loop started");
 
-        glfwPollEvents();
+        if (!headless_cfg.enable)
+            glfwPollEvents();
 
         update_frame_time();
 
-        ui_engine->handleInput();
+        if (!headless_cfg.enable)
+            ui_engine->handleInput();
         render_engine->render();
         physics_engine->step();
 
@@ -88,7 +103,8 @@ void Engine::cleanup()
     }
 
     physics_engine->cleanup();
-    ui_engine->cleanup();
+    if (!headless_cfg.enable)
+        ui_engine->cleanup();
     render_engine->cleanup();
     g_ctx.cleanup();
 
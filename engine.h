@@ -23,10 +23,12 @@ class Engine {
 
     GLFWwindow* window;
     Configuration config;
+    HeadlessConfiguration headless_cfg;
 
     std::chrono::time_point<std::chrono::high_resolution_clock> currentTime = std::chrono::high_resolution_clock::now();
 
     void update_frame_time();
+    bool shouldClose();
 
 public:
     void init(Configuration& config,
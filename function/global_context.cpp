@@ -9,14 +9,21 @@ GlobalContext::~GlobalContext() = default;
 void GlobalContext::init(Configuration& config, GLFWwindow* window)
 {
     vk.init(config, window);
-    dm.init(&vk);
+    dm.init(&vk, config);
+    workers.init(vk.INIT_THREADS);
 
     rm = std::make_unique<ResourceManager>();
     rm->load(config);
 }
 
+uint32_t GlobalContext::frameIndex() const
+{
+    return currentFrame % vk.MAX_FRAMES_IN_FLIGHT;
+}
+
 void GlobalContext::cleanup()
 {
+    workers.cleanup();
     rm->cleanup();
     dm.cleanup();
     vk.cleanup();
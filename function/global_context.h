@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/tool/thread_pool.h"
 #include "core/vulkan/descriptor_manager.h"
 #include "core/vulkan/vulkan_context.h"
 
@@ -16,10 +17,13 @@ struct GlobalContext {
 
     void init(Configuration& config, GLFWwindow* window);
     void cleanup();
+    // which of the per-frame-in-flight resources the current frame uses
+    uint32_t frameIndex() const;
 
     Vk::Context vk;
     Vk::DescriptorManager dm;
     std::unique_ptr<ResourceManager> rm;
+    ThreadPool workers; // vk.INIT_THREADS threads
 
     float frame_time      = 0.0f;
     uint32_t currentFrame = 0;
@@ -15,7 +15,12 @@ void RenderEngine::init_core(const Configuration& config)
     HEIGHT           = config["height"];
     base_window_name = config["name"];
     this->config     = &const_cast<Configuration&>(config);
+    headless         = loadHeadless(config).enable;
 
+    if (headless) {
+        INFO_ALL("Running headless, no window will be created");
+        return;
+    }
     initGLFW();
 }
 
@@ -24,6 +29,10 @@ void RenderEngine::init_render(const Configuration& config, GlobalContext* g_ctx
 {
     this->g_ctx = g_ctx;
     initRenderGraph(fn, std::move(custom_render_graph));
+    g_ctx->vk.pipelineCache.report();
+    g_ctx->rm->mesh_cache.report();
+    g_ctx->vk.allocator.report();
+    g_ctx->rm->draws.report();
 }
 
 void RenderEngine::initRenderGraph(std::function<void(VkCommandBuffer)> fn, std::unique_ptr<RenderGraph> custom_render_graph)
@@ -45,6 +54,8 @@ void RenderEngine::initRenderGraph(std::function<void(VkCommandBuffer)> fn, std:
         render_graph = std::make_unique<FireFieldGraph>();
     } else if (render_graph_cfg.name == "vorticity_field") {
         render_graph = std::make_unique<VorticityFieldGraph>();
+    } else if (render_graph_cfg.name == "custom") {
+        render_graph = std::make_unique<CustomGraph>();
     } else {
         throw std::runtime_error("render graph not found: " + render_graph_cfg.name);
     }
@@ -54,6 +65,11 @@ void RenderEngine::initRenderGraph(std::function<void(VkCommandBuffer)> fn, std:
 
 void RenderEngine::render()
 {
+    if (headless) {
+        drawHeadless();
+        return;
+    }
+
     draw();
 
     auto name = base_window_name + " " + std::to_string(g_ctx->frame_time * 1000) + "ms";
@@ -62,26 +78,27 @@ void RenderEngine::render()
 
 void RenderEngine::draw()
 {
-    vkWaitForFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT], VK_TRUE, UINT64_MAX);
+    uint32_t frame = g_ctx->frameIndex();
+    vkWaitForFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[frame], VK_TRUE, UINT64_MAX);
 
     uint32_t swapchain_index;
     VkResult result = vkAcquireNextImageKHR(
         g_ctx->vk.device,
         g_ctx->vk.swapChain,
         UINT64_MAX,
-        g_ctx->vk.imageAvailableSemaphores[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT],
+        g_ctx->vk.imageAvailableSemaphores[frame],
         VK_NULL_HANDLE,
         &swapchain_index);
     while (result == VK_ERROR_OUT_OF_DATE_KHR) {
         onResize();
         vkWaitForFences(
             g_ctx->vk.device, 1,
-            &g_ctx->vk.inFlightFences[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT],
+            &g_ctx->vk.inFlightFences[frame],
             VK_TRUE, UINT64_MAX);
         result = vkAcquireNextImageKHR(
             g_ctx->vk.device, g_ctx->vk.swapChain,
             UINT64_MAX,
-            g_ctx->vk.imageAvailableSemaphores[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT],
+            g_ctx->vk.imageAvailableSemaphores[frame],
             VK_NULL_HANDLE,
             &swapchain_index);
     }
@@ -89,18 +106,14 @@ void RenderEngine::draw()
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
-    vkResetFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT]);
+    vkResetFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[frame]);
 
-    vkResetCommandBuffer(g_ctx->vk.commandBuffer, 0);
-
-    {
-        render_graph->record(swapchain_index);
-    }
+    const auto& commandBuffers = render_graph->record(swapchain_index);
 
     VkSubmitInfo submitInfo {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    std::vector<VkSemaphore> waitSemaphores = { g_ctx->vk.imageAvailableSemaphores[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT] };
+    std::vector<VkSemaphore> waitSemaphores = { g_ctx->vk.imageAvailableSemaphores[frame] };
     if (g_ctx->currentFrame != 0)
         waitSemaphores.emplace_back(g_ctx->vk.cuUpdateSemaphore);
     std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
@@ -109,17 +122,17 @@ void RenderEngine::draw()
     submitInfo.waitSemaphoreCount = waitSemaphores.size();
     submitInfo.pWaitSemaphores    = waitSemaphores.data();
     submitInfo.pWaitDstStageMask  = waitStages.data();
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &g_ctx->vk.commandBuffer;
+    submitInfo.commandBufferCount = commandBuffers.size();
+    submitInfo.pCommandBuffers    = commandBuffers.data();
 
     VkSemaphore signalSemaphores[] = {
-        g_ctx->vk.renderFinishedSemaphores[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT],
+        g_ctx->vk.renderFinishedSemaphores[swapchain_index],
         g_ctx->vk.vkUpdateSemaphore
     };
     submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores    = signalSemaphores;
 
-    if (vkQueueSubmit(g_ctx->vk.queue, 1, &submitInfo, g_ctx->vk.inFlightFences[g_ctx->currentFrame % MAX_FRAMES_IN_FLIGHT]) != VK_SUCCESS) {
+    if (vkQueueSubmit(g_ctx->vk.queue, 1, &submitInfo, g_ctx->vk.inFlightFences[frame]) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
@@ -141,6 +154,38 @@ void RenderEngine::draw()
     }
 }
 
+void RenderEngine::drawHeadless()
+{
+    uint32_t frame = g_ctx->frameIndex();
+    vkWaitForFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[frame], VK_TRUE, UINT64_MAX);
+    vkResetFences(g_ctx->vk.device, 1, &g_ctx->vk.inFlightFences[frame]);
+
+    // no acquire, every frame in flight has its own offscreen target
+    uint32_t swapchain_index   = frame;
+    const auto& commandBuffers = render_graph->record(swapchain_index);
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    if (g_ctx->currentFrame != 0) {
+        waitSemaphores.emplace_back(g_ctx->vk.cuUpdateSemaphore);
+        waitStages.emplace_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+    submitInfo.waitSemaphoreCount   = waitSemaphores.size();
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
+    submitInfo.commandBufferCount   = commandBuffers.size();
+    submitInfo.pCommandBuffers      = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &g_ctx->vk.vkUpdateSemaphore;
+
+    if (vkQueueSubmit(g_ctx->vk.queue, 1, &submitInfo, g_ctx->vk.inFlightFences[frame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+}
+
 void RenderEngine::registerImGui(std::function<void(VkCommandBuffer)> fn)
 {
     render_graph->registerUIRenderfunction(fn);
@@ -148,6 +193,9 @@ void RenderEngine::registerImGui(std::function<void(VkCommandBuffer)> fn)
 
 void* RenderEngine::toUI()
 {
+    if (headless)
+        return nullptr;
+
     vk2im                 = std::make_unique<Vk2ImGui>();
     vk2im->window         = window;
     vk2im->instance       = g_ctx->vk.instance;
@@ -210,6 +258,8 @@ void RenderEngine::cleanup()
 {
     render_graph->destroy();
 
+    if (headless)
+        return;
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -33,6 +33,7 @@ private:
     void initGLFW();
     void initRenderGraph(std::function<void(VkCommandBuffer)> fn, std::unique_ptr<RenderGraph> custom_render_graph = nullptr);
     void draw();
+    void drawHeadless();
     void onResize();
 
     Configuration* config;
@@ -42,10 +43,9 @@ private:
     uint32_t WIDTH  = 800;
     uint32_t HEIGHT = 600;
 
-    GLFWwindow* window;
+    bool headless      = false;
+    GLFWwindow* window = nullptr;
     std::string base_window_name;
     std::unique_ptr<Vk2ImGui> vk2im;
     bool framebufferResized = false;
-
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 1;
 };
@@ -0,0 +1,175 @@
+#include "barrier_tracker.h"
+#include "function/render/render_graph/render_attachment_description.h"
+#include <stdexcept>
+
+static constexpr VkAccessFlags WRITE_ACCESS
+    = VK_ACCESS_SHADER_WRITE_BIT
+    | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_TRANSFER_WRITE_BIT
+    | VK_ACCESS_HOST_WRITE_BIT
+    | VK_ACCESS_MEMORY_WRITE_BIT;
+
+ImageUsage ImageUsage::FromLayout(VkImageLayout layout, RenderAttachmentRW rw)
+{
+    bool read  = static_cast<uint8_t>(rw & RenderAttachmentRW::Read) != 0;
+    bool write = static_cast<uint8_t>(rw & RenderAttachmentRW::Write) != 0;
+
+    switch (layout) {
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        return {
+            layout,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            (read ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0u) | (write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0u),
+        };
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: // the depth test always reads
+        return {
+            layout,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0u),
+        };
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+        return {
+            layout,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        };
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: // sampled by fragment or compute nodes
+        return {
+            layout,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+        };
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        return {
+            layout,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+        };
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        return TransferDst();
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        return Present();
+    case VK_IMAGE_LAYOUT_GENERAL:
+        return {
+            layout,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            (read ? VK_ACCESS_MEMORY_READ_BIT : 0u) | (write ? VK_ACCESS_MEMORY_WRITE_BIT : 0u),
+        };
+    default:
+        throw std::runtime_error("Unsupported attachment layout");
+    }
+}
+
+ImageUsage ImageUsage::TransferDst()
+{
+    return {
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+    };
+}
+
+ImageUsage ImageUsage::Present()
+{
+    // the presentation engine is synchronized with semaphores
+    return {
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+    };
+}
+
+bool ImageUsage::isWrite() const
+{
+    return (access & WRITE_ACCESS) != 0;
+}
+
+void ImageSyncState::reset(VkPipelineStageFlags stage)
+{
+    write_stage  = stage;
+    write_access = 0;
+    read_stages  = 0;
+}
+
+void BarrierTracker::reserve(size_t count)
+{
+    barriers.reserve(count);
+}
+
+void BarrierTracker::use(Vk::Image& image, ImageSyncState& state, const ImageUsage& usage, bool discard)
+{
+    VkImageLayout old_layout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : image.layout;
+    bool transition          = old_layout != usage.layout;
+    bool write      = usage.isWrite();
+
+    VkPipelineStageFlags wait_stage = 0;
+    VkAccessFlags wait_access       = 0;
+    if (transition || write) {
+        // write after read only needs an execution dependency
+        wait_stage  = state.write_stage | state.read_stages;
+        wait_access = state.write_access;
+    } else if ((state.read_stages & usage.stage) != usage.stage) {
+        // read after write, unless an earlier read in these stages already waited
+        wait_stage  = state.write_stage;
+        wait_access = state.write_access;
+    }
+
+    if (transition || wait_stage != 0) {
+        VkImageMemoryBarrier barrier {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout                       = old_layout;
+        barrier.newLayout                       = usage.layout;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = image.image;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        barrier.srcAccessMask                   = wait_access;
+        barrier.dstAccessMask                   = usage.access;
+        if (image.format == VK_FORMAT_D32_SFLOAT
+            || image.format == VK_FORMAT_D32_SFLOAT_S8_UINT
+            || image.format == VK_FORMAT_D24_UNORM_S8_UINT) {
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        } else {
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+
+        if (transition || wait_access != 0) {
+            barriers.emplace_back(barrier);
+        }
+        src_stage |= wait_stage == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : wait_stage;
+        dst_stage |= usage.stage;
+    }
+
+    image.layout = usage.layout;
+    if (transition || write) {
+        // a layout transition is a write, later accesses have to wait for it
+        state.write_stage  = usage.stage;
+        state.write_access = usage.access & WRITE_ACCESS;
+        state.read_stages  = write ? 0 : usage.stage;
+    } else {
+        state.read_stages |= usage.stage;
+    }
+}
+
+void BarrierTracker::flush(VkCommandBuffer commandBuffer)
+{
+    if (src_stage == 0 && dst_stage == 0)
+        return;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        src_stage,
+        dst_stage,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    barriers.clear();
+    src_stage = 0;
+    dst_stage = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/vulkan/type/image.h"
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+enum class RenderAttachmentRW : uint8_t;
+
+// How an image is accessed, decides the layout and the synchronization scope
+struct ImageUsage {
+    VkImageLayout layout;
+    VkPipelineStageFlags stage;
+    VkAccessFlags access;
+
+    static ImageUsage FromLayout(VkImageLayout layout, RenderAttachmentRW rw);
+    static ImageUsage TransferDst();
+    static ImageUsage Present();
+    bool isWrite() const;
+};
+
+// Synchronization state of an image or of the memory aliased attachments share
+// (render attachments have a single subresource). The layout itself lives in Vk::Image::layout.
+struct ImageSyncState {
+    VkPipelineStageFlags write_stage = 0; // last write or layout transition
+    VkAccessFlags write_access       = 0;
+    VkPipelineStageFlags read_stages = 0; // reads after the last write
+
+    void reset(VkPipelineStageFlags stage = 0);
+};
+
+// Collects the barriers of a node boundary and submits them in a single vkCmdPipelineBarrier
+class BarrierTracker {
+    std::vector<VkImageMemoryBarrier> barriers;
+    VkPipelineStageFlags src_stage = 0;
+    VkPipelineStageFlags dst_stage = 0;
+
+public:
+    void reserve(size_t count);
+    // discard: the content is undefined (e.g. the memory is aliased), transition from UNDEFINED
+    void use(Vk::Image& image, ImageSyncState& state, const ImageUsage& usage, bool discard = false);
+    void flush(VkCommandBuffer commandBuffer);
+};
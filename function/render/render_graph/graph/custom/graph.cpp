@@ -0,0 +1,32 @@
+#include "graph.h"
+#include "function/render/render_graph/node_registry.h"
+
+void CustomGraph::init(Configuration& cfg)
+{
+    JSON_GET(RenderGraphConfiguration, rg_cfg, cfg, "render_graph");
+    if (rg_cfg.nodes.empty())
+        throw std::runtime_error("render graph: the custom graph has no nodes");
+
+    for (const auto& node_cfg : rg_cfg.nodes) {
+        if (nodes.find(node_cfg.name) != nodes.end())
+            throw std::runtime_error("render graph: duplicate node " + node_cfg.name);
+        nodes[node_cfg.name] = RenderGraphNodeRegistry::Create(node_cfg, fn);
+    }
+    initAttachments();
+
+    for (const auto& node_cfg : rg_cfg.nodes) {
+        if (!node_cfg.dependencies.empty())
+            graph[node_cfg.name] = node_cfg.dependencies;
+    }
+    initGraph();
+    initNodes(cfg);
+}
+
+VkRenderPass CustomGraph::getUIRenderpass()
+{
+    for (auto& node : nodes) {
+        if (auto ui = dynamic_cast<UI*>(node.second.get()))
+            return ui->render_pass;
+    }
+    throw std::runtime_error("render graph: the ui needs a node of type ui");
+}
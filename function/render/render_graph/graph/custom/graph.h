@@ -0,0 +1,17 @@
+#pragma once
+
+#include "function/render/render_graph/node/node.h"
+#include "function/render/render_graph/render_graph.h"
+
+// nodes, attachments and edges come from render_graph.nodes in the config
+class CustomGraph : public RenderGraph {
+    std::function<void(VkCommandBuffer)> fn;
+
+public:
+    void init(Configuration& cfg) override;
+    VkRenderPass getUIRenderpass() override;
+    void registerUIRenderfunction(std::function<void(VkCommandBuffer)> fn) override
+    {
+        this->fn = fn;
+    }
+};
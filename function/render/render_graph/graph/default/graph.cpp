@@ -2,8 +2,12 @@
 
 void DefaultGraph::init(Configuration& cfg)
 {
+    nodes["OcclusionCull"]
+        = std::move(std::make_unique<OcclusionCull>("OcclusionCull"));
     nodes["DefaultObject"]
         = std::move(std::make_unique<DefaultObject>("DefaultObject", "object_color", "depth"));
+    nodes["DepthPyramid"]
+        = std::move(std::make_unique<DepthPyramid>("DepthPyramid", "depth"));
     nodes["HDRToSDR"]
         = std::move(std::make_unique<HDRToSDR>("HDRToSDR", "object_color", "sdr_buf"));
     nodes["CalculateLuminance"]
@@ -16,16 +20,15 @@ void DefaultGraph::init(Configuration& cfg)
         = std::move(std::make_unique<Record>("Record", RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()));
     initAttachments();
 
-    for (auto& node : nodes) {
-        node.second->init(cfg, attachments);
-    }
-
     graph = {
-        { "HDRToSDR", { "DefaultObject" } },
+        { "DefaultObject", { "OcclusionCull" } },
+        { "DepthPyramid", { "DefaultObject" } },
+        { "HDRToSDR", { "DefaultObject", "DepthPyramid" } },
         { "CalculateLuminance", { "HDRToSDR" } },
         { "FXAA", { "CalculateLuminance" } },
         { "Record", { "FXAA" } },
         { "UI", { "Record", "FXAA" } },
     };
     initGraph();
+    initNodes(cfg);
 }
@@ -2,8 +2,12 @@
 
 void FireFieldGraph::init(Configuration& cfg)
 {
+    nodes["OcclusionCull"]
+        = std::move(std::make_unique<OcclusionCull>("OcclusionCull"));
     nodes["FireObject"]
         = std::move(std::make_unique<FireObject>("FireObject", "object_color", "depth"));
+    nodes["DepthPyramid"]
+        = std::move(std::make_unique<DepthPyramid>("DepthPyramid", "depth"));
     nodes["FireField"]
         = std::move(std::make_unique<FireFieldNode>("FireField", "object_color", "depth", "field_object_color"));
     nodes["HDRToSDR"]
@@ -18,12 +22,10 @@ void FireFieldGraph::init(Configuration& cfg)
         = std::move(std::make_unique<Record>("Record", RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()));
     initAttachments();
 
-    for (auto& node : nodes) {
-        node.second->init(cfg, attachments);
-    }
-
     graph = {
-        { "FireField", { "FireObject" } },
+        { "FireObject", { "OcclusionCull" } },
+        { "DepthPyramid", { "FireObject" } },
+        { "FireField", { "FireObject", "DepthPyramid" } },
         { "HDRToSDR", { "FireField" } },
         { "CalculateLuminance", { "HDRToSDR" } },
         { "FXAA", { "CalculateLuminance" } },
@@ -31,4 +33,5 @@ void FireFieldGraph::init(Configuration& cfg)
         { "UI", { "Record", "FXAA" } },
     };
     initGraph();
+    initNodes(cfg);
 }
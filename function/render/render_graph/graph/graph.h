@@ -1,3 +1,4 @@
+#include "./custom/graph.h"
 #include "./default/graph.h"
 #include "./fire_field/graph.h"
 #include "./smoke_field/graph.h"
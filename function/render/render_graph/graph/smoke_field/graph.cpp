@@ -2,8 +2,12 @@
 
 void SmokeFieldGraph::init(Configuration& cfg)
 {
+    nodes["OcclusionCull"]
+        = std::move(std::make_unique<OcclusionCull>("OcclusionCull"));
     nodes["DefaultObject"]
         = std::move(std::make_unique<DefaultObject>("DefaultObject", "object_color", "depth"));
+    nodes["DepthPyramid"]
+        = std::move(std::make_unique<DepthPyramid>("DepthPyramid", "depth"));
     nodes["SmokeField"]
         = std::move(std::make_unique<SmokeFieldNode>("SmokeField", "object_color", "depth", "field_object_color"));
     nodes["HDRToSDR"]
@@ -18,12 +22,10 @@ void SmokeFieldGraph::init(Configuration& cfg)
         = std::move(std::make_unique<Record>("Record", RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()));
     initAttachments();
 
-    for (auto& node : nodes) {
-        node.second->init(cfg, attachments);
-    }
-
     graph = {
-        { "SmokeField", { "DefaultObject" } },
+        { "DefaultObject", { "OcclusionCull" } },
+        { "DepthPyramid", { "DefaultObject" } },
+        { "SmokeField", { "DefaultObject", "DepthPyramid" } },
         { "HDRToSDR", { "SmokeField" } },
         { "CalculateLuminance", { "HDRToSDR" } },
         { "FXAA", { "CalculateLuminance" } },
@@ -31,4 +33,5 @@ void SmokeFieldGraph::init(Configuration& cfg)
         { "UI", { "Record", "FXAA" } },
     };
     RenderGraph::initGraph();
+    RenderGraph::initNodes(cfg);
 }
@@ -2,8 +2,12 @@
 
 void VorticityFieldGraph::init(Configuration& cfg)
 {
+    nodes["OcclusionCull"]
+        = std::move(std::make_unique<OcclusionCull>("OcclusionCull"));
     nodes["DefaultObject"]
         = std::move(std::make_unique<DefaultObject>("DefaultObject", "object_color", "depth"));
+    nodes["DepthPyramid"]
+        = std::move(std::make_unique<DepthPyramid>("DepthPyramid", "depth"));
     nodes["VorticityField"]
         = std::move(std::make_unique<VorticityFieldNode>("VorticityField", "object_color", "depth", "field_object_color"));
     nodes["HDRToSDR"]
@@ -18,12 +22,10 @@ void VorticityFieldGraph::init(Configuration& cfg)
         = std::move(std::make_unique<Record>("Record", RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()));
     initAttachments();
 
-    for (auto& node : nodes) {
-        node.second->init(cfg, attachments);
-    }
-
     graph = {
-        { "VorticityField", { "DefaultObject" } },
+        { "DefaultObject", { "OcclusionCull" } },
+        { "DepthPyramid", { "DefaultObject" } },
+        { "VorticityField", { "DefaultObject", "DepthPyramid" } },
         { "HDRToSDR", { "VorticityField" } },
         { "CalculateLuminance", { "HDRToSDR" } },
         { "FXAA", { "CalculateLuminance" } },
@@ -31,4 +33,5 @@ void VorticityFieldGraph::init(Configuration& cfg)
         { "UI", { "Record", "HDRToSDR" } },
     };
     RenderGraph::initGraph();
+    RenderGraph::initNodes(cfg);
 }
@@ -14,7 +14,7 @@ layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    vec3 color = texelFetch(texture2Ds[pipelineParam.sdr_image], ivec2(gl_FragCoord.xy), 0).rgb;
+    vec3 color = texelFetch(texture2Ds[HandleIndex(pipelineParam.sdr_image)], ivec2(gl_FragCoord.xy), 0).rgb;
     float luminance = dot(srgbToLinear(color), vec3(0.2126729f, 0.7151522f, 0.0721750f));
     outColor = vec4(color, luminance);
 }
@@ -92,7 +92,6 @@ void DefaultObject::createPipeline(Configuration& cfg)
         std::vector<VkDescriptorSetLayout> descLayouts = {
             g_ctx.dm.BINDLESS_LAYOUT(),
             g_ctx.dm.PARAMETER_LAYOUT(),
-            g_ctx.dm.PARAMETER_LAYOUT(),
         };
         pipeline.initLayout(descLayouts);
     }
@@ -160,31 +159,29 @@ void DefaultObject::createPipeline(Configuration& cfg)
         pipelineInfo.subpass             = 0;
         pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex   = -1; // Optional
-        if (vkCreateGraphicsPipelines(g_ctx.vk.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
+        pipeline.initPipeline(pipelineInfo, name);
         vkDestroyShaderModule(g_ctx.vk.device, vertShaderModule, nullptr);
         vkDestroyShaderModule(g_ctx.vk.device, fragShaderModule, nullptr);
     }
+}
 
-    {
-        pipeline.param.camera = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
-        pipeline.param.lights = g_ctx.dm.getResourceHandle(g_ctx.rm->lights.buffer.id);
-        pipeline.param_buf    = Buffer::New(
-            g_ctx.vk,
-            sizeof(Param),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            true);
-        pipeline.param_buf.Update(g_ctx.vk, &pipeline.param, sizeof(Param));
-        g_ctx.dm.registerParameter(pipeline.param_buf);
-    }
+void DefaultObject::initDescriptors()
+{
+    pipeline.param.camera    = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
+    pipeline.param.lights    = g_ctx.dm.getResourceHandle(g_ctx.rm->lights.buffer.id);
+    pipeline.param.objects   = g_ctx.rm->draws.objects;
+    pipeline.param.instances = g_ctx.rm->draws.drawnInstances();
+    pipeline.param_block     = g_ctx.dm.allocateParameter(sizeof(Param));
+    g_ctx.dm.updateParameter(pipeline.param_block, &pipeline.param, sizeof(Param));
 }
 
-void DefaultObject::record(uint32_t swapchain_index)
+std::optional<uint64_t> DefaultObject::recordKey()
 {
-    setDefaultViewportAndScissor();
+    return (static_cast<uint64_t>(g_ctx.rm->objects_version) << 32) | g_ctx.rm->objects.size();
+}
 
+void DefaultObject::record(uint32_t swapchain_index)
+{
     std::array<VkClearValue, 2> clearValues {};
     clearValues[0].color        = { { 0.0f, 0.0f, 0.0f, 1.0f } }; // dummy
     clearValues[1].depthStencil = { 1.0f, 0 };
@@ -196,22 +193,13 @@ void DefaultObject::record(uint32_t swapchain_index)
     renderPassInfo.renderArea.extent = toVkExtent2D(g_ctx.vk.swapChainImages[swapchain_index]->extent);
     renderPassInfo.clearValueCount   = clearValues.size();
     renderPassInfo.pClearValues      = clearValues.data();
-    vkCmdBeginRenderPass(g_ctx.vk.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+    vkCmdBeginRenderPass(g_ctx.vk.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    setDefaultViewportAndScissor();
     vkCmdBindPipeline(g_ctx.vk.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
     bindDescriptorSet(0, pipeline.layout, g_ctx.dm.BINDLESS_SET());
-    bindDescriptorSet(1, pipeline.layout, g_ctx.dm.getParameterSet(pipeline.param_buf.id));
-
-    for (const auto& obj : g_ctx.rm->objects) {
-        bindDescriptorSet(2, pipeline.layout, g_ctx.dm.getParameterSet(obj.paramBuffer.id));
-        const auto& mesh = g_ctx.rm->meshes[obj.mesh];
-
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(g_ctx.vk.commandBuffer, 0, 1, &mesh.vertexBuffer.buffer, offsets);
-        vkCmdBindIndexBuffer(g_ctx.vk.commandBuffer, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(g_ctx.vk.commandBuffer, mesh.data.indices.size(), 1, 0, 0, 0);
-    }
-
+    bindParameter(1, pipeline.layout, pipeline.param_block);
+    g_ctx.rm->draws.draw(g_ctx.vk.commandBuffer);
     vkCmdEndRenderPass(g_ctx.vk.commandBuffer);
 }
 
@@ -6,6 +6,8 @@ class DefaultObject : public RenderGraphNode {
     struct Param {
         Vk::DescriptorHandle camera;
         Vk::DescriptorHandle lights;
+        Vk::DescriptorHandle objects;
+        Vk::DescriptorHandle instances;
     };
 
     void createRenderPass();
@@ -24,7 +26,9 @@ public:
         const std::string& depth_buf_name);
 
     virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
+    virtual void initDescriptors() override;
     virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
     virtual void onResize() override;
     virtual void destroy() override;
 };
@@ -0,0 +1,172 @@
+#include "./node.h"
+#include "core/filesystem/file.h"
+#include "core/vulkan/vulkan_util.h"
+#include "function/global_context.h"
+#include "function/render/render_graph/pipeline.hpp"
+#include "function/resource_manager/resource_manager.h"
+#include <algorithm>
+
+using namespace Vk;
+
+static constexpr uint32_t GROUP_SIZE = 8;
+
+DepthPyramid::DepthPyramid(const std::string& name, const std::string& depth_buf_name)
+    : RenderGraphNode(name)
+{
+    attachment_descriptions = {
+        {
+            "depth",
+            RenderAttachmentDescription {
+                depth_buf_name,
+                RenderAttachmentType::Depth | RenderAttachmentType::Sampler,
+                RenderAttachmentRW::Read,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_FORMAT_D32_SFLOAT,
+            },
+        },
+    };
+}
+
+void DepthPyramid::init(Configuration& cfg, RenderAttachments& attachments)
+{
+    this->attachments = &attachments;
+    createPipeline(cfg);
+}
+
+void DepthPyramid::createPipeline(Configuration& cfg)
+{
+    {
+        std::vector<VkDescriptorSetLayout> descLayouts = {
+            g_ctx.dm.BINDLESS_LAYOUT(),
+            g_ctx.dm.PARAMETER_LAYOUT(),
+        };
+        pipeline.initLayout(descLayouts);
+    }
+
+    {
+        JSON_GET(RenderGraphConfiguration, rg_cfg, cfg, "render_graph");
+        auto compShaderCode   = readFile(rg_cfg.shader_directory + "/depth_pyramid/node.comp.spv");
+        auto compShaderModule = createShaderModule(g_ctx.vk, compShaderCode);
+
+        VkComputePipelineCreateInfo pipelineInfo {};
+        pipelineInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage              = Pipeline<Param>::shaderStageDefault(compShaderModule, VK_SHADER_STAGE_COMPUTE_BIT);
+        pipelineInfo.layout             = pipeline.layout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+        pipelineInfo.basePipelineIndex  = -1; // Optional
+        pipeline.initPipeline(pipelineInfo, name);
+        vkDestroyShaderModule(g_ctx.vk.device, compShaderModule, nullptr);
+    }
+}
+
+void DepthPyramid::createLevels()
+{
+    const auto& depth = attachments->getAttachment(attachment_descriptions["depth"].name);
+
+    // the same sizes as pyramidLevelSize() of depth_pyramid.glsl
+    level_sizes.clear();
+    VkExtent2D size { depth.extent.width, depth.extent.height };
+    size_t texels = 0;
+    do {
+        size = { std::max((size.width + 1) / 2, 1u), std::max((size.height + 1) / 2, 1u) };
+        level_sizes.emplace_back(size);
+        texels += size.width * size.height;
+    } while (size.width > 1 || size.height > 1);
+
+    // a resize keeps the handle
+    auto id = levels.id;
+    levels  = Buffer::New(
+        g_ctx.vk,
+        sizeof(float) * texels,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (id != uuid::nil_uuid()) {
+        levels.id = id;
+        g_ctx.dm.updateResourceRegistration(levels);
+    } else {
+        g_ctx.dm.registerResource(levels, DescriptorType::Storage);
+    }
+
+    pipeline.param.camera = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
+    pipeline.param.depth  = g_ctx.dm.getResourceHandle(depth.id);
+    pipeline.param.info   = g_ctx.rm->draws.pyramid;
+    pipeline.param.levels = g_ctx.dm.getResourceHandle(levels.id);
+    pipeline.param.width  = depth.extent.width;
+    pipeline.param.height = depth.extent.height;
+    for (uint32_t i = 0; i < level_sizes.size(); i++) {
+        pipeline.param.level = i;
+        level_blocks.emplace_back(g_ctx.dm.allocateParameter(sizeof(Param)));
+        g_ctx.dm.updateParameter(level_blocks.back(), &pipeline.param, sizeof(Param));
+    }
+}
+
+void DepthPyramid::destroyLevels()
+{
+    for (auto& block : level_blocks)
+        g_ctx.dm.removeParameter(block);
+    level_blocks.clear();
+    Buffer::Delete(g_ctx.vk, levels);
+}
+
+void DepthPyramid::initDescriptors()
+{
+    createLevels();
+}
+
+std::optional<uint64_t> DepthPyramid::recordKey()
+{
+    return level_sizes.size();
+}
+
+void DepthPyramid::record(uint32_t swapchain_index)
+{
+    // the OcclusionCull node of this frame read the last pyramid
+    vkCmdPipelineBarrier(
+        g_ctx.vk.commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr);
+
+    VkMemoryBarrier barrier {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdBindPipeline(g_ctx.vk.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+    bindDescriptorSet(0, pipeline.layout, g_ctx.dm.BINDLESS_SET(), VK_PIPELINE_BIND_POINT_COMPUTE);
+    for (uint32_t i = 0; i < level_sizes.size(); i++) {
+        bindParameter(1, pipeline.layout, level_blocks[i], VK_PIPELINE_BIND_POINT_COMPUTE);
+        vkCmdDispatch(
+            g_ctx.vk.commandBuffer,
+            (level_sizes[i].width + GROUP_SIZE - 1) / GROUP_SIZE,
+            (level_sizes[i].height + GROUP_SIZE - 1) / GROUP_SIZE,
+            1);
+
+        // read by the next level, after the last one by the culling of the next frame
+        vkCmdPipelineBarrier(
+            g_ctx.vk.commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+    }
+}
+
+void DepthPyramid::onResize()
+{
+    destroyLevels();
+    createLevels();
+    // the levels of the last frame are of the old size
+    g_ctx.rm->draws.invalidatePyramid();
+}
+
+void DepthPyramid::destroy()
+{
+    pipeline.destroy();
+    destroyLevels();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "function/render/render_graph/render_graph_node.h"
+
+// Builds the max depth pyramid of the depth of the objects in a storage buffer with a compute dispatch per level
+// and writes SceneDraws::PyramidInfo, the OcclusionCull node of the next frame tests the objects against it
+class DepthPyramid : public RenderGraphNode {
+    struct Param {
+        Vk::DescriptorHandle camera;
+        Vk::DescriptorHandle depth;
+        Vk::DescriptorHandle info;
+        Vk::DescriptorHandle levels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t level;
+    };
+
+    void createPipeline(Configuration& cfg);
+    // for the size of the depth attachment
+    void createLevels();
+    void destroyLevels();
+
+    Pipeline<Param> pipeline;
+    Vk::Buffer levels;
+    std::vector<VkExtent2D> level_sizes;
+    std::vector<Vk::ParameterBlock> level_blocks;
+    RenderAttachments* attachments;
+
+public:
+    DepthPyramid(const std::string& name, const std::string& depth_buf_name);
+
+    virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
+    virtual void initDescriptors() override;
+    virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
+    virtual void onResize() override;
+    virtual void destroy() override;
+};
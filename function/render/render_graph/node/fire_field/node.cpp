@@ -1,10 +1,11 @@
 #include "./node.h"
 #include "core/filesystem/file.h"
-#include "core/tool/sh.h"
+#include "core/tool/shader_compiler.h"
 #include "core/vulkan/vulkan_util.h"
 #include "function/global_context.h"
 #include "function/render/render_graph/pipeline.hpp"
 #include "function/resource_manager/resource_manager.h"
+#include <bit>
 
 using namespace Vk;
 
@@ -137,22 +138,16 @@ void FireFieldNode::createPipeline(Configuration& cfg)
         auto vertShaderCode = readFile(rg_cfg.shader_directory + "/fire_field/node.vert.spv");
 
         auto frag_shader_path = std::filesystem::path(cfg.at("engine_directory").get<std::string>()) / "function/render/render_graph/node/fire_field/node.frag";
-        auto filename         = frag_shader_path.filename().string();
-        auto generated_path   = rg_cfg.shader_directory + "/fire_field/generated/" + filename;
-        auto generated_spv    = rg_cfg.shader_directory + "/fire_field/" + (filename + ".spv");
-        if (!std::filesystem::exists(std::filesystem::path(generated_path).parent_path())) {
-            std::filesystem::create_directories(std::filesystem::path(generated_path).parent_path());
-        }
         JSON_GET(FieldsConfiguration, fields_cfg, cfg, "fields");
-        replaceDefine("FIELD_COUNT", (int)fields_cfg.arr.size(), frag_shader_path, generated_path);
-        replaceDefine("MAX_FIELDS", (int)MAX_FIELDS, generated_path, generated_path);
-        replaceDefine("FIRE_SELF_ILLUMINATION_BOOST",
-                      (int)fields_cfg.fire_configuration.at("self_illumination_boost"), generated_path, generated_path);
-        replaceInclude("../../shader/common.glsl",
-                       "../../common.glsl",
-                       generated_path, generated_path);
-        glslc(generated_path, generated_spv);
-        auto fragShaderCode = readFile(generated_spv);
+        if (fields_cfg.arr.size() > MAX_FIELDS)
+            throw std::runtime_error("fire_field: " + std::to_string(fields_cfg.arr.size()) + " fields, at most " + std::to_string(MAX_FIELDS));
+        // MAX_FIELDS sizes the field parameters, so it is compiled in. The SPIR-V is the same for every run
+        // of this build and comes from the cache, the rest are specialization constants
+        auto fragShaderCode = compileShader(frag_shader_path, { { "MAX_FIELDS", std::to_string(MAX_FIELDS) } }, rg_cfg.shader_directory + "/cache");
+        SpecializationConstants specialization;
+        specialization
+            .set(0, static_cast<int32_t>(fields_cfg.arr.size()))
+            .set(1, fields_cfg.fire_configuration.at("self_illumination_boost").get<float>());
 
         auto vertShaderModule                                     = createShaderModule(g_ctx.vk, vertShaderCode);
         auto fragShaderModule                                     = createShaderModule(g_ctx.vk, fragShaderCode);
@@ -160,6 +155,7 @@ void FireFieldNode::createPipeline(Configuration& cfg)
             Pipeline<Param>::shaderStageDefault(vertShaderModule, VK_SHADER_STAGE_VERTEX_BIT),
             Pipeline<Param>::shaderStageDefault(fragShaderModule, VK_SHADER_STAGE_FRAGMENT_BIT),
         };
+        shaderStages[1].pSpecializationInfo = specialization.get();
         VkPipelineColorBlendAttachmentState colorBlendAttachment {};
         colorBlendAttachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable         = VK_TRUE;
@@ -199,33 +195,26 @@ void FireFieldNode::createPipeline(Configuration& cfg)
         pipelineInfo.subpass             = 0;
         pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex   = -1; // Optional
-        if (vkCreateGraphicsPipelines(g_ctx.vk.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
+        pipeline.initPipeline(pipelineInfo, name);
         vkDestroyShaderModule(g_ctx.vk.device, vertShaderModule, nullptr);
         vkDestroyShaderModule(g_ctx.vk.device, fragShaderModule, nullptr);
     }
+}
 
-    {
-        pipeline.param.camera                   = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
-        pipeline.param.lights                   = g_ctx.dm.getResourceHandle(g_ctx.rm->lights.buffer.id);
-        pipeline.param.self_illumination_lights = g_ctx.dm.getResourceHandle(
-            g_ctx.rm->fields.self_illumination_lights.buffer.id);
-        pipeline.param.fire_color = g_ctx.dm.getResourceHandle(
-            g_ctx.rm->fields.fire_color_img.id);
-        pipeline.param.previous_color = g_ctx.dm.getResourceHandle(
-            attachments->getAttachment(attachment_descriptions["previous_color"].name).id);
-        pipeline.param.previous_depth = g_ctx.dm.getResourceHandle(
-            attachments->getAttachment(attachment_descriptions["previous_depth"].name).id);
-        pipeline.param_buf = Buffer::New(
-            g_ctx.vk,
-            sizeof(Param),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            true);
-        pipeline.param_buf.Update(g_ctx.vk, &pipeline.param, sizeof(Param));
-        g_ctx.dm.registerParameter(pipeline.param_buf);
-    }
+void FireFieldNode::initDescriptors()
+{
+    pipeline.param.camera                   = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
+    pipeline.param.lights                   = g_ctx.dm.getResourceHandle(g_ctx.rm->lights.buffer.id);
+    pipeline.param.self_illumination_lights = g_ctx.dm.getResourceHandle(
+        g_ctx.rm->fields.self_illumination_lights.buffer.id);
+    pipeline.param.fire_color = g_ctx.dm.getResourceHandle(
+        g_ctx.rm->fields.fire_color_img.id);
+    pipeline.param.previous_color = g_ctx.dm.getResourceHandle(
+        attachments->getAttachment(attachment_descriptions["previous_color"].name).id);
+    pipeline.param.previous_depth = g_ctx.dm.getResourceHandle(
+        attachments->getAttachment(attachment_descriptions["previous_depth"].name).id);
+    pipeline.param_block = g_ctx.dm.allocateParameter(sizeof(Param));
+    g_ctx.dm.updateParameter(pipeline.param_block, &pipeline.param, sizeof(Param));
 }
 
 void FireFieldNode::record(uint32_t swapchain_index)
@@ -247,9 +236,8 @@ void FireFieldNode::record(uint32_t swapchain_index)
 
     vkCmdBindPipeline(g_ctx.vk.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
     bindDescriptorSet(0, pipeline.layout, g_ctx.dm.BINDLESS_SET());
-    bindDescriptorSet(1, pipeline.layout, g_ctx.dm.getParameterSet(pipeline.param_buf.id));
-    bindDescriptorSet(2, pipeline.layout,
-                      g_ctx.dm.getParameterSet(g_ctx.rm->fields.paramBuffer.id));
+    bindParameter(1, pipeline.layout, pipeline.param_block);
+    bindParameter(2, pipeline.layout, g_ctx.rm->fields.paramBlock);
     vkCmdPushConstants(
         g_ctx.vk.commandBuffer,
         pipeline.layout,
@@ -264,6 +252,12 @@ void FireFieldNode::record(uint32_t swapchain_index)
     vkCmdEndRenderPass(g_ctx.vk.commandBuffer);
 }
 
+std::optional<uint64_t> FireFieldNode::recordKey()
+{
+    // the step is the only push constant
+    return std::bit_cast<uint32_t>(g_ctx.rm->fields.step);
+}
+
 void FireFieldNode::onResize()
 {
     for (auto& framebuffer : framebuffers) {
@@ -1,8 +1,11 @@
 #version 450
 
-#define FIELD_COUNT 2
+// sizes the field parameters, replaced by MAX_FIELDS of the engine when compiled
 #define MAX_FIELDS 2
-#define FIRE_SELF_ILLUMINATION_BOOST 20.0
+
+// set when the pipeline is created
+layout(constant_id = 0) const int FIELD_COUNT                    = 2;
+layout(constant_id = 1) const float FIRE_SELF_ILLUMINATION_BOOST = 20.0;
 
 #extension GL_GOOGLE_include_directive : enable
 
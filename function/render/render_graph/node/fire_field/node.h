@@ -29,7 +29,9 @@ public:
         const std::string& color_buf);
 
     virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
+    virtual void initDescriptors() override;
     virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
     virtual void onResize() override;
     virtual void destroy() override;
 };
@@ -55,26 +55,21 @@ layout(set = 1, binding = 0) uniform PipelineParam
 }
 pipelineParam;
 
-layout(set = 2, binding = 0) uniform ObjectParam
-{
-    Handle material;
-}
-objectParam;
-
 #define camera GetResource(camera, pipelineParam.camera)
 #define FIRE_LIGHTS GetResource(lights, pipelineParam.fire_lights)
 #define LIGHTS GetResource(lights, pipelineParam.lights)
-#define MATERIAL GetResource(material, objectParam.material)
-#define COLOR_TEXTURE GetResource(textures, MATERIAL.color_texture)
-#define METALLIC_TEXTURE GetResource(textures, MATERIAL.metallic_texture)
-#define ROUGHNESS_TEXTURE GetResource(textures, MATERIAL.roughness_texture)
-#define NORMAL_TEXTURE GetResource(textures, MATERIAL.normal_texture)
-#define AO_TEXTURE GetResource(textures, MATERIAL.ao_texture)
+#define MATERIAL GetResourceNonUniform(material, material_handle)
+#define COLOR_TEXTURE GetResourceNonUniform(textures, MATERIAL.color_texture)
+#define METALLIC_TEXTURE GetResourceNonUniform(textures, MATERIAL.metallic_texture)
+#define ROUGHNESS_TEXTURE GetResourceNonUniform(textures, MATERIAL.roughness_texture)
+#define NORMAL_TEXTURE GetResourceNonUniform(textures, MATERIAL.normal_texture)
+#define AO_TEXTURE GetResourceNonUniform(textures, MATERIAL.ao_texture)
 
 layout(location = 0) in vec3 position_w;
 layout(location = 1) in vec3 normal_w;
 layout(location = 2) in vec2 uv;
 layout(location = 3) in vec3 tangent_w;
+layout(location = 4) flat in Handle material_handle;
 
 layout(location = 0) out vec4 outColor;
 
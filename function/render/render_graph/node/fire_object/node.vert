@@ -19,19 +19,33 @@ layout(set = 0, binding = BindlessUniformBinding) uniform Camera
 }
 camera[];
 
-layout(set = 1, binding = 0) uniform PipelineParam
+struct ObjectParam {
+    Handle material;
+    mat4 model;
+    mat4 modelInvTrans;
+};
+
+layout(set = 0, binding = BindlessStorageBinding) readonly buffer Objects
 {
-    Handle camera;
+    ObjectParam data[];
 }
-pipelineParam;
+objects[];
 
-layout(set = 2, binding = 0) uniform ObjectParam
+layout(set = 0, binding = BindlessStorageBinding) readonly buffer Instances
 {
-    Handle material;
-    mat4 model;
-    mat4 modelInvTrans;
+    uint data[];
+}
+instances[];
+
+layout(set = 1, binding = 0) uniform PipelineParam
+{
+    Handle camera;
+    Handle lights;
+    Handle fire_lights;
+    Handle objects;
+    Handle instances;
 }
-objectParam;
+pipelineParam;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -42,14 +56,19 @@ layout(location = 0) out vec3 position_w;
 layout(location = 1) out vec3 normal_w;
 layout(location = 2) out vec2 uv;
 layout(location = 3) out vec3 tangent_w;
+layout(location = 4) flat out Handle material;
 
-#define GetCamera camera[pipelineParam.camera]
+#define GetCamera camera[HandleIndex(pipelineParam.camera)]
+// gl_InstanceIndex starts at the firstInstance of the batch, its instances hold the object indices
+#define GetInstance instances[HandleIndex(pipelineParam.instances)].data[gl_InstanceIndex]
+#define GetObject objects[HandleIndex(pipelineParam.objects)].data[GetInstance]
 
 void main()
 {
-    gl_Position = GetCamera.proj * GetCamera.view * objectParam.model * vec4(inPosition, 1.0);
-    position_w  = (objectParam.model * vec4(inPosition, 1.0)).xyz;
-    normal_w    = normalize(mat3(objectParam.modelInvTrans) * inNormal);
+    gl_Position = GetCamera.proj * GetCamera.view * GetObject.model * vec4(inPosition, 1.0);
+    position_w  = (GetObject.model * vec4(inPosition, 1.0)).xyz;
+    normal_w    = normalize(mat3(GetObject.modelInvTrans) * inNormal);
     uv          = inUV;
-    tangent_w   = normalize(mat3(objectParam.modelInvTrans) * inTangent);
+    tangent_w   = normalize(mat3(GetObject.modelInvTrans) * inTangent);
+    material    = GetObject.material;
 }
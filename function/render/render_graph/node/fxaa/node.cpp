@@ -75,7 +75,7 @@ void FXAANode::createFramebuffer()
 void FXAANode::createRenderPass()
 {
     std::vector<AttachmentDescriptionHelper> helpers = {
-        { "antialiased", VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE },
+        { "antialiased", VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE },
     };
 
     VkSubpassDependency dependency = {};
@@ -149,26 +149,19 @@ void FXAANode::createPipeline(Configuration& cfg)
         pipelineInfo.subpass             = 0;
         pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex   = -1; // Optional
-        if (vkCreateGraphicsPipelines(g_ctx.vk.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
+        pipeline.initPipeline(pipelineInfo, name);
         vkDestroyShaderModule(g_ctx.vk.device, vertShaderModule, nullptr);
         vkDestroyShaderModule(g_ctx.vk.device, fragShaderModule, nullptr);
     }
+}
 
-    {
-        pipeline.param.original_img = g_ctx.dm.getResourceHandle(
-            attachments->getAttachment(attachment_descriptions["original"].name).id);
-        pipeline.param.camera = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
-        pipeline.param_buf    = Buffer::New(
-            g_ctx.vk,
-            sizeof(Param),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            true);
-        pipeline.param_buf.Update(g_ctx.vk, &pipeline.param, sizeof(Param));
-        g_ctx.dm.registerParameter(pipeline.param_buf);
-    }
+void FXAANode::initDescriptors()
+{
+    pipeline.param.original_img = g_ctx.dm.getResourceHandle(
+        attachments->getAttachment(attachment_descriptions["original"].name).id);
+    pipeline.param.camera = g_ctx.dm.getResourceHandle(g_ctx.rm->camera.buffer.id);
+    pipeline.param_block  = g_ctx.dm.allocateParameter(sizeof(Param));
+    g_ctx.dm.updateParameter(pipeline.param_block, &pipeline.param, sizeof(Param));
 }
 
 void FXAANode::record(uint32_t swapchain_index)
@@ -187,13 +180,18 @@ void FXAANode::record(uint32_t swapchain_index)
 
     vkCmdBindPipeline(g_ctx.vk.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
     bindDescriptorSet(0, pipeline.layout, g_ctx.dm.BINDLESS_SET());
-    bindDescriptorSet(1, pipeline.layout, g_ctx.dm.getParameterSet(pipeline.param_buf.id));
+    bindParameter(1, pipeline.layout, pipeline.param_block);
 
     vkCmdDraw(g_ctx.vk.commandBuffer, 6, 1, 0, 0);
 
     vkCmdEndRenderPass(g_ctx.vk.commandBuffer);
 }
 
+std::optional<uint64_t> FXAANode::recordKey()
+{
+    return 0;
+}
+
 void FXAANode::onResize()
 {
     for (auto& framebuffer : framebuffers) {
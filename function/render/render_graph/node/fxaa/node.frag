@@ -50,7 +50,7 @@ pipelineParam;
 layout(location = 0) out vec4 outColor;
 
 #define camera GetResource(camera, pipelineParam.camera)
-#define buf0 texture2Ds[pipelineParam.original_image]
+#define buf0 texture2Ds[HandleIndex(pipelineParam.original_image)]
 
 vec2 frameBufSize = vec2(camera.width, camera.height);
 vec2 pixelSize    = 1.0 / frameBufSize;
@@ -24,7 +24,9 @@ public:
         const std::string& sdr_buf_alpha_illuminance);
 
     virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
+    virtual void initDescriptors() override;
     virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
     virtual void onResize() override;
     virtual void destroy() override;
 };
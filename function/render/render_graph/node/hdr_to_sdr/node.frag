@@ -26,7 +26,7 @@ vec3 toneRemap(vec3 color)
 
 void main()
 {
-    vec3 color = texelFetch(texture2Ds[pipelineParam.hdr_image], ivec2(gl_FragCoord.xy), 0).rgb;
+    vec3 color = texelFetch(texture2Ds[HandleIndex(pipelineParam.hdr_image)], ivec2(gl_FragCoord.xy), 0).rgb;
     color = toneRemap(color);
     color = linearToSrgb(color);
     color = clamp(color, 0.0, 1.0);
@@ -1,9 +1,11 @@
 #include "./calculate_luminance/node.h"
 #include "./default_object/node.h"
+#include "./depth_pyramid/node.h"
 #include "./fire_field/node.h"
 #include "./fire_object/node.h"
 #include "./fxaa/node.h"
 #include "./hdr_to_sdr/node.h"
+#include "./occlusion_cull/node.h"
 #include "./recorder/node.h"
 #include "./smoke_field/node.h"
 #include "./ui/node.h"
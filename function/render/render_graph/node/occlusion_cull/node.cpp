@@ -0,0 +1,178 @@
+#include "./node.h"
+#include "core/filesystem/file.h"
+#include "core/vulkan/vulkan_util.h"
+#include "function/global_context.h"
+#include "function/render/render_graph/pipeline.hpp"
+#include "function/resource_manager/resource_manager.h"
+#include <cstddef>
+
+using namespace Vk;
+
+static constexpr uint32_t GROUP_SIZE = 64;
+
+OcclusionCull::OcclusionCull(const std::string& name)
+    : RenderGraphNode(name)
+{
+    // the object nodes draw the culled buffers
+    g_ctx.rm->draws.occlusion = true;
+}
+
+void OcclusionCull::init(Configuration& cfg, RenderAttachments& attachments)
+{
+    createPipeline(cfg);
+}
+
+void OcclusionCull::createPipeline(Configuration& cfg)
+{
+    {
+        std::vector<VkDescriptorSetLayout> descLayouts = {
+            g_ctx.dm.BINDLESS_LAYOUT(),
+            g_ctx.dm.PARAMETER_LAYOUT(),
+        };
+        pipeline.initLayout(descLayouts);
+    }
+
+    {
+        JSON_GET(RenderGraphConfiguration, rg_cfg, cfg, "render_graph");
+        auto compShaderCode   = readFile(rg_cfg.shader_directory + "/occlusion_cull/node.comp.spv");
+        auto compShaderModule = createShaderModule(g_ctx.vk, compShaderCode);
+
+        VkComputePipelineCreateInfo pipelineInfo {};
+        pipelineInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage              = Pipeline<Param>::shaderStageDefault(compShaderModule, VK_SHADER_STAGE_COMPUTE_BIT);
+        pipelineInfo.layout             = pipeline.layout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+        pipelineInfo.basePipelineIndex  = -1; // Optional
+        pipeline.initPipeline(pipelineInfo, name);
+        vkDestroyShaderModule(g_ctx.vk.device, compShaderModule, nullptr);
+    }
+}
+
+void OcclusionCull::initDescriptors()
+{
+    // the buffers keep their handles when they grow
+    const auto& draws               = g_ctx.rm->draws;
+    pipeline.param.info             = draws.pyramid;
+    pipeline.param.bounds           = draws.objectBounds;
+    pipeline.param.instances        = draws.instances;
+    pipeline.param.commands         = draws.commands;
+    pipeline.param.slots            = draws.slots;
+    pipeline.param.culled_instances = draws.culledInstances;
+    pipeline.param.culled_commands  = draws.culledCommands;
+    pipeline.param.counter          = draws.counter;
+    pipeline.param_block            = g_ctx.dm.allocateParameter(sizeof(Param));
+    g_ctx.dm.updateParameter(pipeline.param_block, &pipeline.param, sizeof(Param));
+}
+
+std::optional<uint64_t> OcclusionCull::recordKey()
+{
+    // the draw count and the capacity only change with the objects
+    return (static_cast<uint64_t>(g_ctx.rm->objects_version) << 32) | g_ctx.rm->objects.size();
+}
+
+void OcclusionCull::record(uint32_t swapchain_index)
+{
+    const auto& draws  = g_ctx.rm->draws;
+    auto commandBuffer = g_ctx.vk.commandBuffer;
+
+    // the last frame drew the culled buffers, read its counter and built the pyramid
+    VkMemoryBarrier barrier {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+
+    // the commands of the frustum culling with no instances, everything but instanceCount is copied
+    vkCmdFillBuffer(commandBuffer, draws.counterBuffer.buffer, 0, sizeof(uint32_t), 0);
+    if (draws.drawCount != 0) {
+        const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+        vkCmdFillBuffer(commandBuffer, draws.culledIndirectBuffer.buffer, 0, stride * draws.drawCount, 0);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+
+        std::vector<VkBufferCopy> copies;
+        copies.reserve(draws.drawCount * 2);
+        for (uint32_t i = 0; i < draws.drawCount; i++) {
+            VkDeviceSize command = stride * i;
+            copies.push_back({ command + offsetof(VkDrawIndexedIndirectCommand, indexCount),
+                               command + offsetof(VkDrawIndexedIndirectCommand, indexCount),
+                               sizeof(uint32_t) });
+            copies.push_back({ command + offsetof(VkDrawIndexedIndirectCommand, firstIndex),
+                               command + offsetof(VkDrawIndexedIndirectCommand, firstIndex),
+                               stride - offsetof(VkDrawIndexedIndirectCommand, firstIndex) });
+        }
+        vkCmdCopyBuffer(commandBuffer, draws.indirectBuffer.buffer, draws.culledIndirectBuffer.buffer,
+                        static_cast<uint32_t>(copies.size()), copies.data());
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+
+    // a thread per slot of the instance buffer
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+    bindDescriptorSet(0, pipeline.layout, g_ctx.dm.BINDLESS_SET(), VK_PIPELINE_BIND_POINT_COMPUTE);
+    bindParameter(1, pipeline.layout, pipeline.param_block, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdDispatch(commandBuffer, (draws.capacity() + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+
+    // read by SceneDraws::update when this frame slot comes around again
+    VkBufferCopy copy {};
+    copy.srcOffset = 0;
+    copy.dstOffset = sizeof(uint32_t) * g_ctx.frameIndex();
+    copy.size      = sizeof(uint32_t);
+    vkCmdCopyBuffer(commandBuffer, draws.counterBuffer.buffer, draws.readbackBuffer.buffer, 1, &copy);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+}
+
+void OcclusionCull::onResize()
+{
+}
+
+void OcclusionCull::destroy()
+{
+    pipeline.destroy();
+    g_ctx.rm->draws.occlusion = false;
+}
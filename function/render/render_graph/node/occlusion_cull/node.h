@@ -0,0 +1,33 @@
+#pragma once
+
+#include "function/render/render_graph/render_graph_node.h"
+
+// Culls the objects SceneDraws left after the frustum culling against the depth pyramid the DepthPyramid node
+// built in the last frame. The visible instances of a batch are compacted to the front of its range in the
+// culled instance buffer and the culled commands count them, SceneDraws draws those instead
+class OcclusionCull : public RenderGraphNode {
+    struct Param {
+        Vk::DescriptorHandle info;
+        Vk::DescriptorHandle bounds;
+        Vk::DescriptorHandle instances;
+        Vk::DescriptorHandle commands;
+        Vk::DescriptorHandle slots;
+        Vk::DescriptorHandle culled_instances;
+        Vk::DescriptorHandle culled_commands;
+        Vk::DescriptorHandle counter;
+    };
+
+    void createPipeline(Configuration& cfg);
+
+    Pipeline<Param> pipeline;
+
+public:
+    OcclusionCull(const std::string& name);
+
+    virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
+    virtual void initDescriptors() override;
+    virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
+    virtual void onResize() override;
+    virtual void destroy() override;
+};
@@ -2,6 +2,7 @@
 #include "core/vulkan/vulkan_util.h"
 #include "function/global_context.h"
 #include "function/resource_manager/resource_manager.h"
+#include <algorithm>
 
 using namespace Vk;
 
@@ -27,49 +28,102 @@ Record::Record(const std::string& name, const std::string& color_buf_name)
 void Record::init(Configuration& cfg, RenderAttachments& attachments)
 {
     this->attachments = &attachments;
-    createBuffer();
+    createBuffers();
+    g_ctx.rm->recorder.flush = [this] { flush(); };
 }
 
-void Record::createBuffer()
+void Record::createBuffers()
 {
     const auto& image = attachment_descriptions["color"].name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()
         ? *g_ctx.vk.swapChainImages[0]
         : this->attachments->getAttachment(attachment_descriptions["color"].name);
 
-    buffer = Buffer::New(
-        g_ctx.vk,
-        image.size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
+    buffers.resize(g_ctx.vk.MAX_FRAMES_IN_FLIGHT);
+    for (auto& buffer : buffers) {
+        buffer = Buffer::New(
+            g_ctx.vk,
+            image.size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            true);
+    }
+    recorded_at.assign(buffers.size(), 0);
 
     data.resize(image.extent.width * image.extent.height * 4);
 }
 
+void Record::destroyBuffers()
+{
+    for (auto& buffer : buffers) {
+        Buffer::Delete(g_ctx.vk, buffer);
+    }
+    buffers.clear();
+}
+
 void Record::record(uint32_t swapchain_index)
 {
+    // the fence of this frame slot is signaled, so the frame it recorded last time is complete
+    uint32_t frame = g_ctx.frameIndex();
+    auto& buffer   = buffers[frame];
     if (g_ctx.rm->recorder.is_recording) {
         const auto& image = attachment_descriptions["color"].name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()
             ? *g_ctx.vk.swapChainImages[swapchain_index]
             : this->attachments->getAttachment(attachment_descriptions["color"].name);
 
-        image.CopyTo(g_ctx.vk, buffer, image.extent);
-
-        if (is_recording_prev) {
-            memcpy(data.data(), buffer.mapped, image.extent.width * image.extent.height * 4); // we are copying the last frame!
+        if (recorded_at[frame] != 0) {
+            memcpy(data.data(), buffer.mapped, image.extent.width * image.extent.height * 4); // we are copying a previous frame!
             g_ctx.rm->recorder.append(data);
         }
+
+        image.CopyTo(g_ctx.vk, buffer, image.extent);
+        recorded_at[frame] = ++recorded_frames;
+    } else {
+        // flushed when the recording ended
+        recorded_at[frame] = 0;
     }
-    is_recording_prev = g_ctx.rm->recorder.is_recording;
+}
+
+void Record::flush()
+{
+    std::vector<uint32_t> pending;
+    for (uint32_t i = 0; i < recorded_at.size(); i++) {
+        if (recorded_at[i] != 0)
+            pending.emplace_back(i);
+    }
+    if (pending.empty())
+        return;
+
+    vkDeviceWaitIdle(g_ctx.vk.device);
+    std::sort(pending.begin(), pending.end(), [&](uint32_t a, uint32_t b) { return recorded_at[a] < recorded_at[b]; });
+    for (auto i : pending) {
+        memcpy(data.data(), buffers[i].mapped, data.size());
+        g_ctx.rm->recorder.append(data);
+        recorded_at[i] = 0;
+    }
+}
+
+std::optional<uint64_t> Record::recordKey()
+{
+    // record() has to read back the frames while recording
+    if (g_ctx.rm->recorder.is_recording)
+        return std::nullopt;
+    return 0;
 }
 
 void Record::onResize()
 {
-    Buffer::Delete(g_ctx.vk, buffer);
-    createBuffer();
+    // the frames of the old size are appended before their buffers go
+    if (g_ctx.rm->recorder.is_recording)
+        flush();
+    destroyBuffers();
+    createBuffers();
 }
 
 void Record::destroy()
 {
-    Buffer::Delete(g_ctx.vk, buffer);
+    // the frames in flight are appended and the file is closed
+    if (g_ctx.rm->recorder.is_recording)
+        g_ctx.rm->recorder.end();
+    g_ctx.rm->recorder.flush = nullptr;
+    destroyBuffers();
 }
@@ -5,12 +5,17 @@
 // left to right (width), top to bottom (height), B8G8R8A8_UINT8
 // brga, brga....
 class Record : public RenderGraphNode {
-    Vk::Buffer buffer;
+    // one per frame in flight, read back when the frame slot comes around again
+    std::vector<Vk::Buffer> buffers;
+    std::vector<uint64_t> recorded_at; // the frame copied into each buffer, 0 if there is nothing to read back
+    uint64_t recorded_frames = 0;
     RenderAttachments* attachments;
     std::vector<uint8_t> data;
-    bool is_recording_prev = false;
 
-    void createBuffer();
+    void createBuffers();
+    void destroyBuffers();
+    // waits for the frames in flight and appends the ones not read back yet, oldest first
+    void flush();
 
 public:
     Record(
@@ -19,6 +24,7 @@ public:
 
     virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
     virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
     virtual void onResize() override;
     virtual void destroy() override;
 };
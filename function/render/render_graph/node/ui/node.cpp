@@ -77,14 +77,18 @@ void UI::record(uint32_t swapchain_index)
 {
     setDefaultViewportAndScissor();
 
+    // used if the UI is the first to draw to a color buffer, the load is a clear then
+    VkClearValue clearValue {};
+    clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
     VkRenderPassBeginInfo renderPassInfo {};
     renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass        = render_pass;
     renderPassInfo.framebuffer       = framebuffers[swapchain_index];
     renderPassInfo.renderArea.offset = { 0, 0 };
     renderPassInfo.renderArea.extent = toVkExtent2D(g_ctx.vk.swapChainImages[swapchain_index]->extent);
-    renderPassInfo.clearValueCount   = 0;
-    renderPassInfo.pClearValues      = nullptr;
+    renderPassInfo.clearValueCount   = 1;
+    renderPassInfo.pClearValues      = &clearValue;
     vkCmdBeginRenderPass(g_ctx.vk.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
     fn(g_ctx.vk.commandBuffer);
@@ -92,6 +96,15 @@ void UI::record(uint32_t swapchain_index)
     vkCmdEndRenderPass(g_ctx.vk.commandBuffer);
 }
 
+std::optional<uint64_t> UI::recordKey()
+{
+    // ImGui rewrites its vertex buffers every frame, so the graph records the UI into a command buffer of its own
+    // and keeps reusing the nodes before it. Headless there's nothing to draw
+    if (g_ctx.vk.headless)
+        return 0;
+    return std::nullopt;
+}
+
 void UI::onResize()
 {
     for (auto& framebuffer : framebuffers) {
@@ -18,6 +18,7 @@ public:
 
     virtual void init(Configuration& cfg, RenderAttachments& attachments) override;
     virtual void record(uint32_t swapchain_index) override;
+    virtual std::optional<uint64_t> recordKey() override;
     virtual void onResize() override;
     virtual void destroy() override;
 
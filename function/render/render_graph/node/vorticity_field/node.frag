@@ -1,8 +1,11 @@
 #version 450
 
-#define FIELD_COUNT 2
+// sizes the field parameters, replaced by MAX_FIELDS of the engine when compiled
 #define MAX_FIELDS 2
-#define FIRE_SELF_ILLUMINATION_BOOST 20.0
+
+// set when the pipeline is created
+layout(constant_id = 0) const int FIELD_COUNT            = 2;
+layout(constant_id = 1) const float DENSITY_GLOBAL_SCALE = 1.0 / 300.0;
 
 #extension GL_GOOGLE_include_directive : enable
 
@@ -13,7 +16,6 @@ const float EPSILON = 0.0001;
 const int MAX_LIGHTS = 16;
 const float MAX = 100000000;
 const float MIN = -100000000;
-const float DENSITY_GLOBAL_SCALE = 1.0 / 300.0;
 
 const int TYPE_CONCENTRATION = 0;
 const int TYPE_TEMPERATURE = 1;
@@ -0,0 +1,70 @@
+#include "node_registry.h"
+#include "function/render/render_graph/node/node.h"
+#include <stdexcept>
+
+std::unordered_map<std::string, RenderGraphNodeRegistry::Factory>& RenderGraphNodeRegistry::Factories()
+{
+    static std::unordered_map<std::string, Factory> factories = {
+        { "default_object", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<DefaultObject>(cfg.name, Attachment(cfg, "color"), Attachment(cfg, "depth"));
+         } },
+        { "fire_object", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<FireObject>(cfg.name, Attachment(cfg, "color"), Attachment(cfg, "depth"));
+         } },
+        { "fire_field", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<FireFieldNode>(
+                 cfg.name, Attachment(cfg, "previous_color"), Attachment(cfg, "previous_depth"), Attachment(cfg, "color"));
+         } },
+        { "smoke_field", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<SmokeFieldNode>(
+                 cfg.name, Attachment(cfg, "previous_color"), Attachment(cfg, "previous_depth"), Attachment(cfg, "color"));
+         } },
+        { "vorticity_field", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<VorticityFieldNode>(
+                 cfg.name, Attachment(cfg, "previous_color"), Attachment(cfg, "previous_depth"), Attachment(cfg, "color"));
+         } },
+        { "occlusion_cull", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<OcclusionCull>(cfg.name);
+         } },
+        { "depth_pyramid", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<DepthPyramid>(cfg.name, Attachment(cfg, "depth"));
+         } },
+        { "hdr_to_sdr", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<HDRToSDR>(cfg.name, Attachment(cfg, "hdr"), Attachment(cfg, "sdr"));
+         } },
+        { "calculate_luminance", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<CalculateLuminance>(cfg.name, Attachment(cfg, "sdr"), Attachment(cfg, "sdr_alpha_illuminance"));
+         } },
+        { "fxaa", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<FXAANode>(cfg.name, Attachment(cfg, "original"), Attachment(cfg, "antialiased"));
+         } },
+        { "ui", [](const RenderGraphNodeConfiguration& cfg, const UIFunction& ui_fn) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<UI>(cfg.name, Attachment(cfg, "color"), ui_fn);
+         } },
+        { "record", [](const RenderGraphNodeConfiguration& cfg, const UIFunction&) -> std::unique_ptr<RenderGraphNode> {
+             return std::make_unique<Record>(cfg.name, Attachment(cfg, "color"));
+         } },
+    };
+    return factories;
+}
+
+void RenderGraphNodeRegistry::Register(const std::string& type, Factory factory)
+{
+    Factories()[type] = std::move(factory);
+}
+
+std::unique_ptr<RenderGraphNode> RenderGraphNodeRegistry::Create(const RenderGraphNodeConfiguration& cfg, const UIFunction& ui_fn)
+{
+    auto it = Factories().find(cfg.type);
+    if (it == Factories().end())
+        throw std::runtime_error("render graph: unknown node type " + cfg.type + " of " + cfg.name);
+    return it->second(cfg, ui_fn);
+}
+
+const std::string& RenderGraphNodeRegistry::Attachment(const RenderGraphNodeConfiguration& cfg, const std::string& name)
+{
+    auto it = cfg.attachments.find(name);
+    if (it == cfg.attachments.end())
+        throw std::runtime_error("render graph: node " + cfg.name + " needs the attachment " + name);
+    return it->second;
+}
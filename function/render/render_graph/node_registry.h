@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/config/config.h"
+#include "function/render/render_graph/render_graph_node.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Creates the nodes of a render graph described in the config by their type.
+// The builtin nodes are registered on first use, custom nodes can be added with Register().
+class RenderGraphNodeRegistry {
+public:
+    using UIFunction = std::function<void(VkCommandBuffer)>;
+    using Factory    = std::function<std::unique_ptr<RenderGraphNode>(const RenderGraphNodeConfiguration& cfg, const UIFunction& ui_fn)>;
+
+    static void Register(const std::string& type, Factory factory);
+    static std::unique_ptr<RenderGraphNode> Create(const RenderGraphNodeConfiguration& cfg, const UIFunction& ui_fn);
+    // the graph's attachment bound to the node's attachment, throws if it isn't given
+    static const std::string& Attachment(const RenderGraphNodeConfiguration& cfg, const std::string& name);
+
+private:
+    static std::unordered_map<std::string, Factory>& Factories();
+};
@@ -4,6 +4,7 @@
 #include "core/vulkan/vulkan_util.h"
 #include "function/global_context.h"
 #include "function/type/vertex.h"
+#include <cstring>
 #include <vulkan/vulkan_core.h>
 
 #define VertexInputDefault(hasVertexInput)                                                                 \
@@ -51,12 +52,45 @@
     viewportState.scissorCount  = 1;                                                     \
     viewportState.pScissors     = &scissor;
 
+// Values of the specialization constants (layout(constant_id = ...)) of a shader stage,
+// one SPIR-V makes pipelines for different values without compiling again
+class SpecializationConstants {
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint8_t> data;
+    VkSpecializationInfo info {};
+
+public:
+    template <typename V>
+    SpecializationConstants& set(uint32_t constant_id, const V& value)
+    {
+        static_assert(sizeof(V) == 4, "int, uint, float or VkBool32");
+        VkSpecializationMapEntry entry {};
+        entry.constantID = constant_id;
+        entry.offset     = static_cast<uint32_t>(data.size());
+        entry.size       = sizeof(V);
+        entries.emplace_back(entry);
+        data.resize(data.size() + sizeof(V));
+        memcpy(data.data() + entry.offset, &value, sizeof(V));
+        return *this;
+    }
+
+    // valid until the next set()
+    const VkSpecializationInfo* get()
+    {
+        info.mapEntryCount = static_cast<uint32_t>(entries.size());
+        info.pMapEntries   = entries.data();
+        info.dataSize      = data.size();
+        info.pData         = data.data();
+        return &info;
+    }
+};
+
 template <typename T>
 struct Pipeline {
     VkPipelineLayout layout = VK_NULL_HANDLE;
     VkPipeline pipeline     = VK_NULL_HANDLE;
     T param;
-    Vk::Buffer param_buf;
+    Vk::ParameterBlock param_block;
 
     void destroy()
     {
@@ -69,9 +103,7 @@ struct Pipeline {
         } else {
             assert(pipeline == VK_NULL_HANDLE);
         }
-        if (param_buf.id != uuid::nil_uuid()) {
-            Vk::Buffer::Delete(g_ctx.vk, param_buf);
-        }
+        g_ctx.dm.removeParameter(param_block);
     }
 
     static VkPipelineInputAssemblyStateCreateInfo inputAssemblyDefault()
@@ -130,4 +162,14 @@ struct Pipeline {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
+
+    // through the pipeline cache of the context, name is for the log
+    void initPipeline(const VkGraphicsPipelineCreateInfo& info, const std::string& name)
+    {
+        pipeline = g_ctx.vk.pipelineCache.createGraphicsPipeline(info, name);
+    }
+    void initPipeline(const VkComputePipelineCreateInfo& info, const std::string& name)
+    {
+        pipeline = g_ctx.vk.pipelineCache.createComputePipeline(info, name);
+    }
 };
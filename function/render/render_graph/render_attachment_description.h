@@ -19,4 +19,7 @@ struct RenderAttachmentDescription {
     VkImageLayout layout;
     VkImageUsageFlags usage;
     VkFormat format;
+
+    // set by the render graph: no earlier node touches this attachment in a frame
+    bool first_access = false;
 };
@@ -1,7 +1,11 @@
 #include "render_attachments.h"
+#include "core/tool/logger.h"
 #include "core/vulkan/type/image.h"
+#include "core/vulkan/vulkan_util.h"
 #include "function/global_context.h"
 #include "render_attachment_description.h"
+#include <algorithm>
+#include <climits>
 
 using namespace Vk;
 
@@ -26,33 +30,161 @@ VkImageAspectFlags RenderAttachments::getAspectFlags(RenderAttachmentType type)
 void RenderAttachments::addAttachment(const std::string& name, RenderAttachmentType type, VkImageUsageFlags usage, VkFormat format)
 {
     assert(name != RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME());
+    assert(memory_groups.empty() && "Attachments are added before allocate()");
     RenderAttachment attachment;
-    attachment.name  = name;
-    attachment.type  = type;
-    attachment.usage = usage;
-    attachment.image = Image::New(
-        g_ctx.vk,
-        format,
-        g_ctx.vk.swapChainImages[0]->extent,
-        usage,
-        getAspectFlags(type),
-        VK_MEMORY_HEAP_DEVICE_LOCAL_BIT);
-    attachment.image.TransitionLayoutSingleTime(g_ctx.vk, VK_IMAGE_LAYOUT_GENERAL);
-    if (static_cast<uint8_t>(type & RenderAttachmentType::Sampler) != 0) {
-        attachment.image.AddDefaultSampler(g_ctx.vk);
-        g_ctx.dm.registerResource(attachment.image, DescriptorType::CombinedImageSampler);
-    }
-    attachments[name] = std::move(attachment);
+    attachment.name         = name;
+    attachment.type         = type;
+    attachment.usage        = usage;
+    attachment.image.format = format;
+    attachments[name]       = std::move(attachment);
 }
 
 void RenderAttachments::removeAttachment(const std::string& name)
 {
     assert(name != RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME());
-    auto& attachment = attachments[name];
-    attachment.destroy();
+    assert(memory_groups.empty() && "Attachments are removed before allocate()");
     attachments.erase(name);
 }
 
+void RenderAttachments::allocate(const std::unordered_map<std::string, std::pair<int, int>>& lifetimes)
+{
+    this->lifetimes = lifetimes;
+    createImages();
+}
+
+void RenderAttachments::createImages()
+{
+    struct Candidate {
+        RenderAttachment* attachment;
+        VkMemoryRequirements requirements;
+        std::pair<int, int> lifetime;
+    };
+    std::vector<Candidate> candidates;
+    VkDeviceSize dedicated_size = 0;
+    for (auto& a : attachments) {
+        auto& image  = a.second.image;
+        image.extent = g_ctx.vk.swapChainImages[0]->extent;
+
+        VkImageCreateInfo imageInfo {};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.extent        = image.extent;
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.format        = image.format;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage         = a.second.usage;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateImage(g_ctx.vk.device, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(g_ctx.vk.device, image.image, &requirements);
+        image.size = requirements.size;
+        dedicated_size += requirements.size;
+
+        // an attachment no node uses is kept alive for the whole frame
+        auto it = lifetimes.find(a.first);
+        candidates.push_back({
+            &a.second,
+            requirements,
+            it == lifetimes.end() ? std::make_pair(-1, INT_MAX) : it->second,
+        });
+    }
+
+    // the largest attachments open the groups, smaller ones fill the gaps in their lifetimes
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.requirements.size != b.requirements.size)
+            return a.requirements.size > b.requirements.size;
+        return a.attachment->name < b.attachment->name;
+    });
+    memory_groups.clear();
+    for (const auto& c : candidates) {
+        uint32_t memory_type = findMemoryType(g_ctx.vk, c.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        uint32_t group = 0;
+        for (; group < memory_groups.size(); group++) {
+            const auto& g = memory_groups[group];
+            if (g.memory_type != memory_type)
+                continue;
+            bool overlap = std::any_of(g.lifetimes.begin(), g.lifetimes.end(), [&](const std::pair<int, int>& l) {
+                return l.first <= c.lifetime.second && c.lifetime.first <= l.second;
+            });
+            if (!overlap)
+                break;
+        }
+        if (group == memory_groups.size()) {
+            memory_groups.emplace_back();
+            memory_groups.back().memory_type = memory_type;
+        }
+
+        auto& g = memory_groups[group];
+        g.size  = std::max(g.size, c.requirements.size);
+        g.attachments.emplace_back(c.attachment);
+        g.lifetimes.emplace_back(c.lifetime);
+        c.attachment->memory_group = group;
+    }
+
+    VkDeviceSize aliased_size = 0;
+    for (auto& g : memory_groups) {
+        VkMemoryAllocateInfo allocInfo {};
+        allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize  = g.size;
+        allocInfo.memoryTypeIndex = g.memory_type;
+        if (vkAllocateMemory(g_ctx.vk.device, &allocInfo, nullptr, &g.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+        aliased_size += g.size;
+
+        std::string names;
+        for (auto attachment : g.attachments) {
+            auto& image = attachment->image;
+            if (vkBindImageMemory(g_ctx.vk.device, image.image, g.memory, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind image memory!");
+            }
+            image.allocation = {};
+            image.view    = createImageView(g_ctx.vk, image.image, image.format, getAspectFlags(attachment->type), VK_IMAGE_VIEW_TYPE_2D, 1);
+            image.layout  = VK_IMAGE_LAYOUT_UNDEFINED;
+            image.sampler = VK_NULL_HANDLE;
+            image.TransitionLayoutSingleTime(g_ctx.vk, VK_IMAGE_LAYOUT_GENERAL);
+            if (image.id == uuid::nil_uuid())
+                image.CreateUUID();
+            if (static_cast<uint8_t>(attachment->type & RenderAttachmentType::Sampler) != 0) {
+                image.AddDefaultSampler(g_ctx.vk);
+                // recreated after a resize, the nodes keep the handle
+                if (g_ctx.dm.isRegistered(image.id))
+                    g_ctx.dm.updateResourceRegistration(image);
+                else
+                    g_ctx.dm.registerResource(image, DescriptorType::CombinedImageSampler);
+            }
+            names += " " + attachment->name;
+        }
+        if (g.attachments.size() > 1)
+            DEBUG_ALL("render attachments aliased:" + names);
+    }
+
+    INFO_ALL("render attachments: "
+             + std::to_string(attachments.size()) + " images in "
+             + std::to_string(memory_groups.size()) + " allocations, "
+             + std::to_string(aliased_size >> 20) + " MB instead of "
+             + std::to_string(dedicated_size >> 20) + " MB, "
+             + std::to_string((dedicated_size - aliased_size) >> 20) + " MB saved");
+}
+
+void RenderAttachments::destroyImages()
+{
+    for (auto& a : attachments) {
+        a.second.destroy();
+    }
+    for (auto& g : memory_groups) {
+        vkFreeMemory(g_ctx.vk.device, g.memory, nullptr);
+    }
+    memory_groups.clear();
+}
+
 Vk::Image& RenderAttachments::getAttachment(const std::string& name)
 {
     assert(name != RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME());
@@ -64,31 +196,11 @@ Vk::Image& RenderAttachments::getAttachment(const std::string& name)
 }
 void RenderAttachments::onResize()
 {
-    for (auto& a : attachments) {
-        auto id = a.second.image.id;
-        if (a.second.image.sampler != VK_NULL_HANDLE)
-            g_ctx.dm.removeResourceRegistration(id);
-        Image::Delete(g_ctx.vk, a.second.image);
-
-        a.second.image = Image::New(
-            g_ctx.vk,
-            a.second.image.format,
-            g_ctx.vk.swapChainImages[0]->extent,
-            a.second.usage,
-            getAspectFlags(a.second.type),
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        a.second.image.TransitionLayoutSingleTime(g_ctx.vk, VK_IMAGE_LAYOUT_GENERAL);
-        a.second.image.id = id;
-        if (static_cast<uint8_t>(a.second.type & RenderAttachmentType::Sampler) != 0) {
-            a.second.image.AddDefaultSampler(g_ctx.vk);
-            g_ctx.dm.registerResource(a.second.image, DescriptorType::CombinedImageSampler);
-        }
-    }
+    destroyImages();
+    createImages();
 }
 
 void RenderAttachments::cleanup()
 {
-    for (auto& a : attachments) {
-        a.second.destroy();
-    }
+    destroyImages();
 }
@@ -2,8 +2,11 @@
 
 #include "core/tool/enum_bit_op.h"
 #include "core/vulkan/type/image.h"
+#include "function/render/render_graph/barrier_tracker.h"
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 enum class RenderAttachmentType : uint8_t {
     Color   = 1 << 0,
@@ -15,24 +18,46 @@ DEFINE_ENUM_BIT_OPERATORS(RenderAttachmentType)
 struct RenderAttachment {
     std::string name;
 
-    Vk::Image image;
+    Vk::Image image; // the memory is owned by the memory group
     VkImageUsageFlags usage;
     RenderAttachmentType type;
+    uint32_t memory_group;
     void destroy();
 };
 
+// attachments whose lifetimes don't overlap share one allocation
+struct RenderAttachmentMemory {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size     = 0;
+    uint32_t memory_type  = 0;
+    // accesses to the memory, whichever attachment made them
+    ImageSyncState sync;
+    std::vector<RenderAttachment*> attachments;
+    std::vector<std::pair<int, int>> lifetimes;
+};
+
 class RenderAttachments {
     static VkImageAspectFlags getAspectFlags(RenderAttachmentType type);
+    void createImages();
+    void destroyImages();
+
+    // first and last node using an attachment, in execution order
+    std::unordered_map<std::string, std::pair<int, int>> lifetimes;
 
 public:
     // you need to specify the complete type and usage.
     // type can't only be sampler.
+    // the image is created in allocate()
     void addAttachment(const std::string& name, RenderAttachmentType type, VkImageUsageFlags usage, VkFormat format);
+    // before allocate()
     void removeAttachment(const std::string& name);
+    // creates the images, attachments with disjoint lifetimes are aliased
+    void allocate(const std::unordered_map<std::string, std::pair<int, int>>& lifetimes);
     Vk::Image& getAttachment(const std::string& name);
     void onResize();
 
     void cleanup();
 
     std::unordered_map<std::string, RenderAttachment> attachments;
+    std::vector<RenderAttachmentMemory> memory_groups;
 };
@@ -1,36 +1,49 @@
 #include "render_graph.h"
+#include "core/tool/logger.h"
+#include "core/vulkan/vulkan_util.h"
+#include "function/resource_manager/resource_manager.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
 #include <queue>
+#include <unordered_set>
 
 void RenderGraph::clearAttachments()
 {
-    for (auto& attachment : attachments.attachments) {
-        auto layout = attachment.second.image.layout;
-        attachment.second.image.TransitionLayout(g_ctx.vk, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    if (cleared_attachments.empty())
+        return;
 
+    // the attachments stay in TRANSFER_DST, the barrier before the first node using them moves them out
+    for (auto attachment : cleared_attachments) {
+        useAttachment(*attachment, ImageUsage::TransferDst(), true);
+    }
+    barriers.flush(g_ctx.vk.commandBuffer);
+
+    for (auto attachment : cleared_attachments) {
         VkImageSubresourceRange range = {};
         range.baseMipLevel            = 0;
         range.levelCount              = 1;
         range.baseArrayLayer          = 0;
         range.layerCount              = 1;
-        if (static_cast<uint8_t>(attachment.second.type & RenderAttachmentType::Color) != 0) {
+        if (static_cast<uint8_t>(attachment->type & RenderAttachmentType::Color) != 0) {
             VkClearColorValue clearColor = {};
             clearColor                   = { { 0.0f, 0.0f, 0.0f, 1.0f } };
             range.aspectMask             = VK_IMAGE_ASPECT_COLOR_BIT;
             vkCmdClearColorImage(
                 g_ctx.vk.commandBuffer,
-                attachment.second.image.image,
+                attachment->image.image,
                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
         }
-        if (static_cast<uint8_t>(attachment.second.type & RenderAttachmentType::Depth) != 0) {
+        if (static_cast<uint8_t>(attachment->type & RenderAttachmentType::Depth) != 0) {
             VkClearDepthStencilValue clearValue = {};
             clearValue                          = { 1.0f, 0 };
             range.aspectMask                    = VK_IMAGE_ASPECT_DEPTH_BIT;
             vkCmdClearDepthStencilImage(
                 g_ctx.vk.commandBuffer,
-                attachment.second.image.image,
+                attachment->image.image,
                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
         }
-        attachment.second.image.TransitionLayout(g_ctx.vk, layout);
     }
 }
 
@@ -49,6 +62,157 @@ void RenderGraph::initGraph()
             starting_nodes.emplace_back(node.first);
         }
     }
+
+    validateGraph();
+    compileGraph();
+}
+
+void RenderGraph::validateGraph()
+{
+    for (const auto& edge : graph) {
+        if (nodes.find(edge.first) == nodes.end())
+            throw std::runtime_error("render graph: unknown node " + edge.first);
+        for (const auto& dependency : edge.second) {
+            if (nodes.find(dependency) == nodes.end())
+                throw std::runtime_error("render graph: " + edge.first + " depends on unknown node " + dependency);
+        }
+    }
+
+    // nodes that don't lead to a node writing the swapchain image do useless work
+    std::unordered_set<std::string> reachable;
+    std::queue<std::string> queue;
+    for (const auto& node : nodes) {
+        for (const auto& desc_pair : node.second->attachment_descriptions) {
+            if (desc_pair.second.name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()
+                && static_cast<uint8_t>(desc_pair.second.rw & RenderAttachmentRW::Write) != 0) {
+                if (reachable.insert(node.first).second)
+                    queue.emplace(node.first);
+            }
+        }
+    }
+    while (!queue.empty()) {
+        std::string name = queue.front();
+        queue.pop();
+        auto it = graph.find(name);
+        if (it == graph.end())
+            continue;
+        for (const auto& dependency : it->second) {
+            if (reachable.insert(dependency).second)
+                queue.emplace(dependency);
+        }
+    }
+    for (const auto& node : nodes) {
+        if (reachable.find(node.first) == reachable.end())
+            WARN_ALL("render graph: " + node.first + " is unreachable from the swapchain image");
+    }
+}
+
+void RenderGraph::compileGraph()
+{
+    execution_order.clear();
+    transitions.clear();
+    transition_offsets.clear();
+    cleared_attachments.clear();
+
+    auto degree = in_degree;
+    std::queue<std::string> queue;
+    for (const auto& node : starting_nodes) {
+        queue.emplace(node);
+    }
+    while (!queue.empty()) {
+        std::string name = queue.front();
+        queue.pop();
+        execution_order.emplace_back(nodes[name].get());
+
+        for (const auto& next_node : rev_graph[name]) {
+            degree[next_node]--;
+            if (degree[next_node] == 0) {
+                queue.emplace(next_node);
+            }
+        }
+    }
+    if (execution_order.size() != nodes.size()) {
+        std::string cycle;
+        for (const auto& d : degree) {
+            if (d.second > 0)
+                cycle += " " + d.first;
+        }
+        throw std::runtime_error("render graph: cycle between nodes" + cycle);
+    }
+
+    // lifetimes of the attachments over the execution order, -1 is the clear before the first node
+    std::unordered_map<std::string, std::pair<int, int>> lifetimes;
+    bool swapchain_accessed = false;
+    for (int i = 0; i < execution_order.size(); i++) {
+        auto node = execution_order[i];
+        for (auto& desc_pair : node->attachment_descriptions) {
+            auto& desc        = desc_pair.second;
+            desc.first_access = desc.name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()
+                ? !swapchain_accessed
+                : lifetimes.find(desc.name) == lifetimes.end();
+        }
+        for (const auto& desc_pair : node->attachment_descriptions) {
+            const auto& desc = desc_pair.second;
+            if (desc.name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()) {
+                swapchain_accessed = true;
+                continue;
+            }
+            auto it = lifetimes.find(desc.name);
+            if (it != lifetimes.end()) {
+                it->second.second = i;
+                continue;
+            }
+            if (desc.layout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                && desc.layout != VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+                cleared_attachments.emplace_back(&attachments.attachments.at(desc.name));
+                lifetimes[desc.name] = { -1, i };
+            } else {
+                lifetimes[desc.name] = { i, i };
+            }
+        }
+    }
+    attachments.allocate(lifetimes);
+
+    size_t max_transitions = 1;
+    for (auto node : execution_order) {
+        size_t begin = transitions.size();
+        transition_offsets.emplace_back(static_cast<uint32_t>(begin));
+        for (const auto& desc_pair : node->attachment_descriptions) {
+            const auto& desc             = desc_pair.second;
+            RenderAttachment* attachment = nullptr;
+            if (desc.name != RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()) {
+                auto it = attachments.attachments.find(desc.name);
+                if (it == attachments.attachments.end())
+                    throw std::runtime_error("Attachment not found: " + desc.name);
+                attachment = &it->second;
+            }
+            ImageUsage usage  = ImageUsage::FromLayout(desc.layout, desc.rw);
+            bool first_access = desc.first_access
+                && std::find(cleared_attachments.begin(), cleared_attachments.end(), attachment) == cleared_attachments.end();
+
+            // one node accessing an attachment twice is merged into one usage
+            auto same = std::find_if(transitions.begin() + begin, transitions.end(), [&](const CompiledTransition& t) {
+                return t.attachment == attachment;
+            });
+            if (same == transitions.end()) {
+                transitions.push_back({ attachment, usage, first_access });
+            } else if (same->usage.layout != usage.layout) {
+                throw std::runtime_error("render graph: " + node->name + " uses " + desc.name + " in two layouts");
+            } else {
+                same->usage.stage |= usage.stage;
+                same->usage.access |= usage.access;
+            }
+        }
+        max_transitions = std::max(max_transitions, transitions.size() - begin);
+    }
+    transition_offsets.emplace_back(static_cast<uint32_t>(transitions.size()));
+    ImageUsage present = g_ctx.vk.headless
+        ? ImageUsage::FromLayout(g_ctx.vk.presentLayout(), RenderAttachmentRW::Read)
+        : ImageUsage::Present();
+    transitions.push_back({ nullptr, present, false });
+    transition_offsets.emplace_back(static_cast<uint32_t>(transitions.size()));
+
+    barriers.reserve(std::max(max_transitions, attachments.attachments.size()));
 }
 
 void RenderGraph::initAttachments()
@@ -75,62 +239,273 @@ void RenderGraph::initAttachments()
     }
 }
 
-void RenderGraph::prepareAttachmentsForNode(const auto& node, uint32_t swapchain_index)
+void RenderGraph::initNodes(Configuration& cfg)
 {
-    for (const auto& desc_pair : node->attachment_descriptions) {
-        auto& image = desc_pair.second.name == RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME()
-            ? *g_ctx.vk.swapChainImages[swapchain_index]
-            : attachments.getAttachment(desc_pair.second.name);
-        image.TransitionLayout(g_ctx.vk, desc_pair.second.layout);
+    auto start = std::chrono::steady_clock::now();
+
+    // shader compilation and pipeline creation of a node don't depend on the other nodes
+    std::vector<std::future<void>> tasks;
+    for (auto& node : nodes) {
+        auto n = node.second.get();
+        if (g_ctx.workers.size() == 0) {
+            n->init(cfg, attachments);
+            continue;
+        }
+        tasks.emplace_back(g_ctx.workers.submit([this, n, cfg](uint32_t) mutable {
+            n->init(cfg, attachments);
+        }));
+    }
+    // wait for every node before rethrowing, the others still use the attachments
+    std::exception_ptr error;
+    for (auto& task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    for (auto& node : nodes) {
+        node.second->initDescriptors();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    INFO_ALL("render graph: initialized " + std::to_string(nodes.size()) + " nodes in "
+             + std::to_string(std::chrono::duration<float, std::milli>(end - start).count()) + "ms");
+}
+
+void RenderGraph::transitionAttachments(uint32_t begin, uint32_t end, uint32_t swapchain_index)
+{
+    for (uint32_t i = begin; i < end; i++) {
+        const auto& transition = transitions[i];
+        if (transition.attachment == nullptr) {
+            barriers.use(*g_ctx.vk.swapChainImages[swapchain_index], swapchain_sync[swapchain_index], transition.usage);
+        } else {
+            useAttachment(*transition.attachment, transition.usage, transition.first_access);
+        }
+    }
+    barriers.flush(g_ctx.vk.commandBuffer);
+}
+
+void RenderGraph::useAttachment(RenderAttachment& attachment, const ImageUsage& usage, bool first_access)
+{
+    // an aliased attachment was overwritten by the others sharing its memory since its last use
+    auto& memory = attachments.memory_groups[attachment.memory_group];
+    barriers.use(attachment.image, memory.sync, usage, first_access && memory.attachments.size() > 1);
+}
+
+void RenderGraph::recordKeys()
+{
+    keys.clear();
+    for (auto node : execution_order) {
+        auto key = node->recordKey();
+        if (!key.has_value())
+            return;
+        keys.emplace_back(*key);
+    }
+}
+
+void RenderGraph::recordNodes(size_t begin, size_t end, uint32_t swapchain_index)
+{
+    for (size_t i = begin; i < end; i++) {
+        transitionAttachments(transition_offsets[i], transition_offsets[i + 1], swapchain_index);
+        execution_order[i]->record(swapchain_index);
+    }
+    if (end == execution_order.size())
+        transitionAttachments(transition_offsets[end], transition_offsets[end + 1], swapchain_index);
+}
+
+void RenderGraph::syncState(uint32_t swapchain_index, std::vector<uint32_t>& out)
+{
+    out.clear();
+    for (const auto& memory : attachments.memory_groups) {
+        for (auto attachment : memory.attachments) {
+            out.emplace_back(static_cast<uint32_t>(attachment->image.layout));
+            out.insert(out.end(), { memory.sync.write_stage, memory.sync.write_access, memory.sync.read_stages });
+        }
+    }
+    // the synchronization of an acquired image starts over every frame
+    const auto& sync = swapchain_sync[swapchain_index];
+    out.emplace_back(static_cast<uint32_t>(g_ctx.vk.swapChainImages[swapchain_index]->layout));
+    if (g_ctx.vk.headless)
+        out.insert(out.end(), { sync.write_stage, sync.write_access, sync.read_stages });
+}
+
+void RenderGraph::saveState(uint32_t swapchain_index, std::vector<uint32_t>& out)
+{
+    out.clear();
+    for (const auto& memory : attachments.memory_groups) {
+        out.insert(out.end(), { memory.sync.write_stage, memory.sync.write_access, memory.sync.read_stages });
+        for (auto attachment : memory.attachments)
+            out.emplace_back(static_cast<uint32_t>(attachment->image.layout));
+    }
+    const auto& sync = swapchain_sync[swapchain_index];
+    out.emplace_back(static_cast<uint32_t>(g_ctx.vk.swapChainImages[swapchain_index]->layout));
+    out.insert(out.end(), { sync.write_stage, sync.write_access, sync.read_stages });
+}
+
+void RenderGraph::restoreState(uint32_t swapchain_index, const std::vector<uint32_t>& in)
+{
+    size_t i = 0;
+    for (auto& memory : attachments.memory_groups) {
+        memory.sync.write_stage  = in[i++];
+        memory.sync.write_access = in[i++];
+        memory.sync.read_stages  = in[i++];
+        for (auto attachment : memory.attachments)
+            attachment->image.layout = static_cast<VkImageLayout>(in[i++]);
+    }
+    auto& sync                                        = swapchain_sync[swapchain_index];
+    g_ctx.vk.swapChainImages[swapchain_index]->layout = static_cast<VkImageLayout>(in[i++]);
+    sync.write_stage                                  = in[i++];
+    sync.write_access                                 = in[i++];
+    sync.read_stages                                  = in[i++];
+}
+
+void RenderGraph::allocateRecordedFrames()
+{
+    recorded_frames.resize(g_ctx.vk.MAX_FRAMES_IN_FLIGHT);
+    for (auto& frame_recorded : recorded_frames) {
+        frame_recorded.resize(g_ctx.vk.swapChainImages.size());
+        for (auto& r : frame_recorded) {
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool        = g_ctx.vk.commandPool;
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(g_ctx.vk.device, &allocInfo, &r.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffers!");
+            }
+        }
+    }
+
+    tail_command_buffers.resize(g_ctx.vk.MAX_FRAMES_IN_FLIGHT);
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool        = g_ctx.vk.commandPool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(tail_command_buffers.size());
+    if (vkAllocateCommandBuffers(g_ctx.vk.device, &allocInfo, tail_command_buffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
     }
 }
 
-void RenderGraph::record(uint32_t swapchain_index)
+void RenderGraph::freeRecordedFrames()
 {
+    for (auto& frame_recorded : recorded_frames) {
+        for (auto& r : frame_recorded) {
+            vkFreeCommandBuffers(g_ctx.vk.device, g_ctx.vk.commandPool, 1, &r.commandBuffer);
+        }
+    }
+    recorded_frames.clear();
+    if (!tail_command_buffers.empty()) {
+        vkFreeCommandBuffers(g_ctx.vk.device, g_ctx.vk.commandPool, static_cast<uint32_t>(tail_command_buffers.size()), tail_command_buffers.data());
+        tail_command_buffers.clear();
+    }
+}
+
+const std::vector<VkCommandBuffer>& RenderGraph::record(uint32_t swapchain_index)
+{
+    uint32_t frame = g_ctx.frameIndex();
+    submitted.clear();
+    // meshes, textures and field frames uploaded since the last frame are submitted before it,
+    // with the finished async uploads
+    g_ctx.vk.transfer.poll();
+    // objects added or removed since the last frame
+    g_ctx.rm->draws.update();
+    g_ctx.vk.staging.flush();
+    // descriptors registered or updated since the last frame
+    g_ctx.dm.flush();
+
     VkCommandBufferBeginInfo beginInfo {};
     beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr; // Optional
-    if (vkBeginCommandBuffer(g_ctx.vk.commandBuffer, &beginInfo) != VK_SUCCESS) {
-        throw std::runtime_error("failed to begin recording command buffer!");
-    }
 
-    clearAttachments();
+    // the uploads have their own command buffer, updating the camera, lights or parameters
+    // doesn't change the commands of the graph
+    if (g_ctx.vk.uploader.pending()) {
+        auto uploadCommandBuffer = g_ctx.vk.commandBuffers[frame];
+        vkResetCommandBuffer(uploadCommandBuffer, 0);
+        if (vkBeginCommandBuffer(uploadCommandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        g_ctx.vk.uploader.flush(uploadCommandBuffer, frame);
+        if (vkEndCommandBuffer(uploadCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+        submitted.emplace_back(uploadCommandBuffer);
+    }
 
-    auto degree = in_degree;
-    std::queue<std::string> queue;
-    for (const auto& node : starting_nodes) {
-        queue.emplace(node);
+    if (recorded_frames.empty())
+        allocateRecordedFrames();
+    if (swapchain_sync.size() != g_ctx.vk.swapChainImages.size())
+        swapchain_sync.resize(g_ctx.vk.swapChainImages.size());
+    if (!g_ctx.vk.headless) {
+        // the image is acquired once the imageAvailable semaphore is signaled at this stage
+        swapchain_sync[swapchain_index].reset(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
     }
-    while (!queue.empty()) {
-        std::string name = queue.front();
-        auto& node       = nodes[name];
-        queue.pop();
-        degree[name] = -1;
 
-        {
-            prepareAttachmentsForNode(node, swapchain_index);
-            node->record(swapchain_index);
+    // the fence of this frame slot is signaled, so its command buffers aren't pending
+    auto& recorded = recorded_frames[frame][swapchain_index];
+    recordKeys();
+    syncState(swapchain_index, state);
+    const size_t split = keys.size();
+    const bool reuse   = recorded.reusable && !keys.empty() && recorded.keys == keys && recorded.state == state;
+    if (reuse) {
+        submitted.emplace_back(recorded.commandBuffer);
+        restoreState(swapchain_index, recorded.split_state);
+    } else {
+        g_ctx.vk.commandBuffer = recorded.commandBuffer;
+        vkResetCommandBuffer(g_ctx.vk.commandBuffer, 0);
+        beginInfo.flags = 0; // may be submitted again
+        if (vkBeginCommandBuffer(g_ctx.vk.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        clearAttachments();
+        recordNodes(0, split, swapchain_index);
+        if (vkEndCommandBuffer(g_ctx.vk.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
         }
+        submitted.emplace_back(recorded.commandBuffer);
 
-        for (const auto& next_node : rev_graph[name]) {
-            if (degree[next_node] == -1)
-                continue;
-            degree[next_node]--;
-            if (degree[next_node] == 0) {
-                queue.emplace(next_node);
-            }
+        recorded.keys  = keys;
+        recorded.state = state;
+        saveState(swapchain_index, recorded.split_state);
+    }
+
+    if (split < execution_order.size()) {
+        g_ctx.vk.commandBuffer = tail_command_buffers[frame];
+        vkResetCommandBuffer(g_ctx.vk.commandBuffer, 0);
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(g_ctx.vk.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
         }
+        recordNodes(split, execution_order.size(), swapchain_index);
+        if (vkEndCommandBuffer(g_ctx.vk.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+        submitted.emplace_back(g_ctx.vk.commandBuffer);
     }
-    g_ctx.vk.swapChainImages[swapchain_index]->TransitionLayout(g_ctx.vk, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-    if (vkEndCommandBuffer(g_ctx.vk.commandBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("failed to record command buffer!");
+    // the barriers are only right again if the commands of the whole frame leave the images in the state
+    // they found them, which isn't the case in the first frames after init or resize
+    if (!reuse) {
+        recorded.reusable = false;
+        if (!keys.empty()) {
+            syncState(swapchain_index, state);
+            recorded.reusable = recorded.state == state;
+        }
     }
+    return submitted;
 }
 
 void RenderGraph::onResize()
 {
+    // the framebuffers and attachment views of the recorded frames are recreated
+    freeRecordedFrames();
     attachments.onResize();
     for (auto& node : nodes) {
         node.second->onResize();
@@ -139,6 +514,7 @@ void RenderGraph::onResize()
 
 void RenderGraph::destroy()
 {
+    freeRecordedFrames();
     for (auto& node : nodes)
         node.second->destroy();
     attachments.cleanup();
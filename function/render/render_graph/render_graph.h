@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/config/config.h"
+#include "function/render/render_graph/barrier_tracker.h"
 #include "function/render/render_graph/node/node.h"
 #include "function/render/render_graph/render_attachments.h"
 #include "function/render/render_graph/render_graph_node.h"
@@ -19,16 +20,63 @@ protected:
     std::unordered_map<std::string, int> in_degree;
     std::vector<std::string> starting_nodes;
 
+    // resolved once in initGraph(), record() only walks these arrays
+    struct CompiledTransition {
+        RenderAttachment* attachment; // nullptr is the swapchain image of the frame
+        ImageUsage usage;
+        bool first_access; // the content before is not needed
+    };
+    std::vector<RenderGraphNode*> execution_order;
+    // transitions before execution_order[i] are [transition_offsets[i], transition_offsets[i + 1]),
+    // the last range moves the swapchain image to its present layout
+    std::vector<CompiledTransition> transitions;
+    std::vector<uint32_t> transition_offsets;
+    std::vector<ImageSyncState> swapchain_sync;
+    // attachments first accessed outside of a render pass, the others are cleared by load ops
+    std::vector<RenderAttachment*> cleared_attachments;
+    BarrierTracker barriers;
+
+    // one primary per frame in flight and swapchain image, submitted again without recording
+    // while the record keys of the nodes and the states of the images it uses are unchanged.
+    // It holds the nodes before the first one changing every frame (the UI), that one and the
+    // ones after it are recorded every frame into the tail command buffer of the frame slot
+    struct RecordedFrame {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        bool reusable                 = false;
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> state; // the images are left in the state the commands expect
+        std::vector<uint32_t> split_state; // after commandBuffer, the tail is recorded from it
+    };
+    std::vector<std::vector<RecordedFrame>> recorded_frames; // [frame][swapchain image]
+    std::vector<VkCommandBuffer> tail_command_buffers; // [frame]
+    std::vector<VkCommandBuffer> submitted;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> state;
+
+    void recordKeys(); // the keys of the nodes before the first one changing every frame
+    void syncState(uint32_t swapchain_index, std::vector<uint32_t>& out);
+    // the tracked layouts and synchronization of the images, in the middle of a frame
+    void saveState(uint32_t swapchain_index, std::vector<uint32_t>& out);
+    void restoreState(uint32_t swapchain_index, const std::vector<uint32_t>& in);
+    void recordNodes(size_t begin, size_t end, uint32_t swapchain_index);
+    void allocateRecordedFrames();
+    void freeRecordedFrames();
+
     virtual void clearAttachments();
     void initGraph();
-    void prepareAttachmentsForNode(const auto& node, uint32_t swapchain_index);
+    void compileGraph();
+    void validateGraph();
+    void transitionAttachments(uint32_t begin, uint32_t end, uint32_t swapchain_index);
+    void useAttachment(RenderAttachment& attachment, const ImageUsage& usage, bool first_access);
     void initAttachments();
+    // after initGraph(), the render passes depend on the first access of each attachment
+    void initNodes(Configuration& cfg);
 
 public:
     virtual ~RenderGraph()                = default;
     virtual void init(Configuration& cfg) = 0;
-    // record all the render commands
-    virtual void record(uint32_t swapchain_index);
+    // record all the render commands, returns the command buffers to submit in order
+    virtual const std::vector<VkCommandBuffer>& record(uint32_t swapchain_index);
     virtual void onResize();
     virtual void destroy();
 
@@ -13,11 +13,18 @@ VkRenderPass RenderGraphNode::DefaultRenderPass(
 {
     std::vector<VkAttachmentDescription> attachments;
     for (const auto& d : desc) {
+        // nothing was written before the first access, loading means loading the cleared value
+        auto load_op = d.load_op;
+        if (load_op == VK_ATTACHMENT_LOAD_OP_LOAD
+            && attachment_descriptions[d.name].first_access
+            && attachment_descriptions[d.name].name != RenderAttachmentDescription::SWAPCHAIN_IMAGE_NAME())
+            load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+
         attachments.push_back(
             {
                 .format         = attachment_descriptions[d.name].format,
                 .samples        = VK_SAMPLE_COUNT_1_BIT,
-                .loadOp         = static_cast<VkAttachmentLoadOp>(d.load_op),
+                .loadOp         = load_op,
                 .storeOp        = static_cast<VkAttachmentStoreOp>(d.store_op),
                 .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
                 .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
@@ -67,11 +74,17 @@ VkRenderPass RenderGraphNode::DefaultRenderPass(
     return render_pass;
 }
 
-void RenderGraphNode::bindDescriptorSet(uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set)
+void RenderGraphNode::bindDescriptorSet(uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set, VkPipelineBindPoint bind_point)
+{
+    bindDescriptorSet(g_ctx.vk.commandBuffer, index, layout, set, bind_point);
+}
+
+void RenderGraphNode::bindDescriptorSet(
+    VkCommandBuffer commandBuffer, uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set, VkPipelineBindPoint bind_point)
 {
     vkCmdBindDescriptorSets(
-        g_ctx.vk.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        commandBuffer,
+        bind_point,
         layout,
         index,
         1,
@@ -80,7 +93,32 @@ void RenderGraphNode::bindDescriptorSet(uint32_t index, VkPipelineLayout layout,
         nullptr);
 }
 
+void RenderGraphNode::bindParameter(uint32_t index, VkPipelineLayout layout, const Vk::ParameterBlock& block, VkPipelineBindPoint bind_point)
+{
+    bindParameter(g_ctx.vk.commandBuffer, index, layout, block, bind_point);
+}
+
+void RenderGraphNode::bindParameter(
+    VkCommandBuffer commandBuffer, uint32_t index, VkPipelineLayout layout, const Vk::ParameterBlock& block, VkPipelineBindPoint bind_point)
+{
+    assert(block.valid());
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        bind_point,
+        layout,
+        index,
+        1,
+        g_ctx.dm.PARAMETER_SET(),
+        1,
+        &block.offset);
+}
+
 void RenderGraphNode::setDefaultViewportAndScissor()
+{
+    setDefaultViewportAndScissor(g_ctx.vk.commandBuffer);
+}
+
+void RenderGraphNode::setDefaultViewportAndScissor(VkCommandBuffer commandBuffer)
 {
     VkViewport viewport {};
     viewport.x        = 0.0f;
@@ -89,11 +127,11 @@ void RenderGraphNode::setDefaultViewportAndScissor()
     viewport.height   = static_cast<float>(g_ctx.vk.swapChainImages[0]->extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(g_ctx.vk.commandBuffer, 0, 1, &viewport);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     VkRect2D scissor {};
     scissor.offset = { 0, 0 };
     scissor.extent = Vk::toVkExtent2D(g_ctx.vk.swapChainImages[0]->extent);
-    vkCmdSetScissor(g_ctx.vk.commandBuffer, 0, 1, &scissor);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
 Vk::Image* RenderGraphNode::getAttachmentByName(const std::string& name, RenderAttachments* attachments, int swapchain_index)
@@ -3,6 +3,7 @@
 #include "core/config/config.h"
 #include "function/render/render_graph/pipeline.hpp"
 #include "function/render/render_graph/render_attachment_description.h"
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -10,6 +11,8 @@ class RenderGraphNode {
 protected:
     struct AttachmentDescriptionHelper {
         std::string name;
+        // LOAD on the first access of an attachment becomes CLEAR (black, depth 1),
+        // DONT_CARE if the pass overwrites every pixel
         VkAttachmentLoadOp load_op;
         VkAttachmentStoreOp store_op;
     };
@@ -17,8 +20,18 @@ protected:
         std::unordered_map<std::string, RenderAttachmentDescription>& attachment_descriptions,
         const std::vector<AttachmentDescriptionHelper>& desc,
         VkSubpassDependency& dependency);
-    void bindDescriptorSet(uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set);
+    // bind_point is compute for the compute nodes
+    void bindDescriptorSet(uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set,
+                           VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
+    void bindDescriptorSet(VkCommandBuffer commandBuffer, uint32_t index, VkPipelineLayout layout, VkDescriptorSet* set,
+                           VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
+    // the parameter set of the descriptor manager at the offset of block
+    void bindParameter(uint32_t index, VkPipelineLayout layout, const Vk::ParameterBlock& block,
+                       VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
+    void bindParameter(VkCommandBuffer commandBuffer, uint32_t index, VkPipelineLayout layout, const Vk::ParameterBlock& block,
+                       VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
     void setDefaultViewportAndScissor();
+    void setDefaultViewportAndScissor(VkCommandBuffer commandBuffer);
     Vk::Image* getAttachmentByName(const std::string& name, RenderAttachments* attachments, int swapchain_index);
 
 public:
@@ -26,8 +39,15 @@ public:
     RenderGraphNode(const std::string& name);
     virtual ~RenderGraphNode() = default;
 
+    // render pass, framebuffers, shaders and pipelines. The nodes of a graph are initialized at the same time
+    // on g_ctx.workers, so init() gets its own copy of cfg and must not touch the descriptor manager
     virtual void init(Configuration& cfg, RenderAttachments& attachments) = 0;
-    virtual void record(uint32_t swapchain_index)                         = 0;
+    // after init() of all the nodes, one node at a time: parameter blocks and descriptor registration
+    virtual void initDescriptors() { }
+    virtual void record(uint32_t swapchain_index) = 0;
+    // identifies the commands record() produces, the graph submits its recorded command buffer again
+    // while the keys of all the nodes are unchanged. nullopt: the commands change every frame
+    virtual std::optional<uint64_t> recordKey() { return std::nullopt; }
     virtual void onResize()                                               = 0;
     virtual void destroy()                                                = 0;
 
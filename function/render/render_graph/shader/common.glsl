@@ -8,9 +8,16 @@
 
 #define GetLayoutVariableName(Name) u##Name##Register
 
+// The index in the bindless array, the upper bits of a handle are the type and a generation
+#define HandleIndex(handle) ((handle) & 0xFFFFFu)
+
 // Access a specific resource
 #define GetResource(Name, Index) \
-    GetLayoutVariableName(Name)[Index]
+    GetLayoutVariableName(Name)[HandleIndex(Index)]
+
+// When the handle differs within a draw, e.g. the material of an object drawn indirectly
+#define GetResourceNonUniform(Name, Index) \
+    GetLayoutVariableName(Name)[nonuniformEXT(HandleIndex(Index))]
 
 layout(set = BindlessDescriptorSet, binding = BindlessSamplerBinding)
     uniform sampler2D texture2Ds[];
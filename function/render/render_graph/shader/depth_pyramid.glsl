@@ -0,0 +1,43 @@
+// The max depth pyramid of the DepthPyramid node, read by the OcclusionCull node.
+// Level 0 is half of the depth attachment rounded up and every level halves the one below until 1x1,
+// so texel t of level l covers the pixels [t, t + 1) * 2^(l + 1) of the depth attachment
+
+layout(set = 0, binding = BindlessStorageBinding) buffer PyramidInfo
+{
+    mat4 view;
+    mat4 proj;
+    uvec2 depth_size;
+    Handle levels;
+    uint valid;
+}
+pyramidInfo[];
+
+layout(set = 0, binding = BindlessStorageBinding) buffer PyramidLevels
+{
+    float data[];
+}
+pyramidLevels[];
+
+uvec2 pyramidLevelSize(uvec2 depth_size, uint level)
+{
+    return max((depth_size + (2u << level) - 1u) >> (level + 1u), uvec2(1));
+}
+
+uint pyramidLevelCount(uvec2 depth_size)
+{
+    uint count = 1;
+    while (any(greaterThan(pyramidLevelSize(depth_size, count - 1), uvec2(1))))
+        count++;
+    return count;
+}
+
+// of the first texel of level in the levels buffer
+uint pyramidLevelOffset(uvec2 depth_size, uint level)
+{
+    uint offset = 0;
+    for (uint i = 0; i < level; i++) {
+        uvec2 size = pyramidLevelSize(depth_size, i);
+        offset += size.x * size.y;
+    }
+    return offset;
+}
@@ -1,5 +1,6 @@
 #include "resource_manager.h"
 #include "function/global_context.h"
+#include <algorithm>
 
 using namespace Vk;
 
@@ -12,11 +13,16 @@ void ResourceManager::load(Configuration& config)
     JSON_GET(std::vector<LightConfiguration>, lights_cfg, config, "lights");
     lights = Lights::fromConfiguration(lights_cfg);
 
+    std::string mesh_cache_path = config.at("render_graph").value("shader_directory", std::string(".")) + "/cache/meshes";
+    if (config.contains("mesh_cache"))
+        mesh_cache_path = config["mesh_cache"].get<std::string>();
+    mesh_cache.init(mesh_cache_path);
     JSON_GET(std::vector<MeshConfiguration>, mesh_cfg, config, "meshes");
     for (auto& cfg : mesh_cfg) {
-        auto mesh         = Mesh::fromConfiguration(cfg);
+        auto mesh         = Mesh::fromConfiguration(cfg, &mesh_cache);
         meshes[mesh.name] = mesh;
     }
+    draws.initGeometry(meshes);
 
     loadDefaultTextures();
     JSON_GET(std::vector<TextureConfiguration>, texture_cfg, config, "textures");
@@ -39,12 +45,53 @@ void ResourceManager::load(Configuration& config)
 
     JSON_GET(std::vector<ObjectConfiguration>, objects_cfg, config, "objects");
     for (auto& cfg : objects_cfg) {
-        objects.emplace_back(Object::fromConfiguration(cfg));
+        addObject(cfg);
     }
+    if (config.contains("lod_error"))
+        draws.lod_error = config["lod_error"].get<float>();
+    draws.initObjects(objects);
+
+    // the meshes, textures and fields were uploaded on the transfer queue while the next files were read
+    g_ctx.vk.transfer.wait(g_ctx.vk.transfer.latest());
 
     recorder.init(config);
 }
 
+Object& ResourceManager::addObject(ObjectConfiguration& cfg)
+{
+    if (meshes.find(cfg.mesh) == meshes.end()) {
+        throw std::runtime_error("mesh not found: " + cfg.mesh);
+    }
+    // first, so the draws don't write the transform of the new object to the slot of another one
+    objects_version++;
+    objects.emplace_back(Object::fromConfiguration(cfg));
+    objects.back().index = static_cast<uint32_t>(objects.size() - 1);
+    return objects.back();
+}
+
+void ResourceManager::removeObject(const std::string& name)
+{
+    auto it = std::find_if(objects.begin(), objects.end(), [&](const Object& object) { return object.name == name; });
+    if (it == objects.end()) {
+        throw std::runtime_error("object not found: " + name);
+    }
+    it->destroy();
+    objects.erase(it);
+    for (uint32_t i = 0; i < objects.size(); i++) {
+        objects[i].index = i;
+    }
+    objects_version++;
+}
+
+void ResourceManager::setObjectMesh(Object& object, const std::string& mesh)
+{
+    if (meshes.find(mesh) == meshes.end()) {
+        throw std::runtime_error("mesh not found: " + mesh);
+    }
+    object.mesh = mesh;
+    objects_version++;
+}
+
 void ResourceManager::addResource(std::unique_ptr<Resource> resource)
 {
     if (resources.find(resource->name) != resources.end()) {
@@ -73,9 +120,7 @@ void ResourceManager::cleanup()
 
     camera.destroy();
     lights.destroy();
-    for (auto& mesh : meshes) {
-        mesh.second.destroy();
-    }
+    draws.destroy();
     for (auto& mat : materials) {
         mat.second.destroy();
     }
@@ -3,6 +3,8 @@
 #include "core/config/config.h"
 #include "core/tool/recorder.h"
 #include "function/resource_manager/resource.h"
+#include "function/resource_manager/scene_draws.h"
+#include "function/tool/mesh_cache.h"
 #include "function/type/camera.h"
 #include "function/type/field.h"
 #include "function/type/light.h"
@@ -16,10 +18,16 @@ public:
     Camera camera;
     Lights lights;
     std::unordered_map<std::string, Mesh> meshes;
+    // of the file meshes
+    MeshCache mesh_cache;
     std::unordered_map<std::string, Material> materials;
     std::unordered_map<std::string, Texture> textures;
 
     std::vector<Object> objects;
+    // bumped by addObject(), removeObject() and setObjectMesh(), the recorded draws are reused until then.
+    // Bump it too after changing the material of an object
+    uint32_t objects_version = 0;
+    SceneDraws draws;
     Fields fields;
 
     Recorder recorder;
@@ -27,6 +35,9 @@ public:
     std::unordered_map<std::string, std::unique_ptr<Resource>> resources;
 
     void load(Configuration& config);
+    Object& addObject(ObjectConfiguration& cfg);
+    void removeObject(const std::string& name);
+    void setObjectMesh(Object& object, const std::string& mesh);
     void addResource(std::unique_ptr<Resource> resource);
     void removeResource(const std::string& name);
     void cleanup();
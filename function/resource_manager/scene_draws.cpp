@@ -0,0 +1,384 @@
+#include "scene_draws.h"
+#include "core/tool/logger.h"
+#include "function/global_context.h"
+#include "function/resource_manager/resource_manager.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <numeric>
+
+using namespace Vk;
+
+// how much the model matrix stretches the local space at most
+static float maxScale(const glm::mat4& model)
+{
+    return std::sqrt(std::max({ glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                                glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                                glm::dot(glm::vec3(model[2]), glm::vec3(model[2])) }));
+}
+
+void SceneDraws::initGeometry(std::unordered_map<std::string, Mesh>& meshes)
+{
+    size_t vertex_count = 0;
+    size_t index_count  = 0;
+    for (auto& mesh : meshes) {
+        mesh.second.vertexOffset = static_cast<int32_t>(vertex_count);
+        mesh.second.firstIndex   = static_cast<uint32_t>(index_count);
+        vertex_count += mesh.second.vertices().size();
+        index_count += mesh.second.indices(0).size();
+        for (uint32_t lod = 1; lod < mesh.second.lodCount(); lod++) {
+            mesh.second.lods[lod - 1].firstIndex = static_cast<uint32_t>(index_count);
+            index_count += mesh.second.indices(lod).size();
+        }
+    }
+
+    vertexBuffer = Buffer::New(
+        g_ctx.vk,
+        sizeof(Vertex) * std::max<size_t>(vertex_count, 1),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    indexBuffer = Buffer::New(
+        g_ctx.vk,
+        sizeof(uint32_t) * std::max<size_t>(index_count, 1),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    // a cached mesh is read straight from its mapped file
+    for (const auto& [name, mesh] : meshes) {
+        auto vertices = mesh.vertices();
+        if (vertices.empty() || mesh.indices(0).empty())
+            continue;
+        vertexBuffer.UpdateAsync(g_ctx.vk, vertices.data(), sizeof(Vertex) * vertices.size(),
+                                 sizeof(Vertex) * mesh.vertexOffset);
+        for (uint32_t lod = 0; lod < mesh.lodCount(); lod++) {
+            auto indices = mesh.indices(lod);
+            indexBuffer.UpdateAsync(g_ctx.vk, indices.data(), sizeof(uint32_t) * indices.size(),
+                                    sizeof(uint32_t) * (lod == 0 ? mesh.firstIndex : mesh.lods[lod - 1].firstIndex));
+        }
+    }
+}
+
+void SceneDraws::initObjects(const std::vector<Object>& objects)
+{
+    pyramidBuffer = Buffer::New(
+        g_ctx.vk,
+        sizeof(PyramidInfo),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    pyramid = g_ctx.dm.registerResource(pyramidBuffer, DescriptorType::Storage);
+    invalidatePyramid();
+    counterBuffer = Buffer::New(
+        g_ctx.vk,
+        sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    counter        = g_ctx.dm.registerResource(counterBuffer, DescriptorType::Storage);
+    readbackBuffer = Buffer::New(
+        g_ctx.vk,
+        sizeof(uint32_t) * g_ctx.vk.MAX_FRAMES_IN_FLIGHT,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        true);
+    memset(readbackBuffer.mapped, 0, readbackBuffer.size);
+
+    createObjectBuffers(static_cast<uint32_t>(objects.size()));
+    writeObjects(objects, false);
+    objects_version = g_ctx.rm->objects_version;
+
+    // the first update culls them
+    visible.resize(objects.size());
+    std::iota(visible.begin(), visible.end(), 0);
+    writeDraws(false);
+}
+
+void SceneDraws::createObjectBuffers(uint32_t capacity)
+{
+    object_capacity = std::max(capacity, 1u);
+    slot_capacity   = object_capacity * Mesh::MAX_LODS;
+
+    // larger buffers keep the handles the pipelines have
+    auto create = [&](Buffer& buffer, DescriptorHandle& handle, size_t size, VkBufferUsageFlags usage) {
+        auto id = buffer.id;
+        buffer  = Buffer::New(
+            g_ctx.vk,
+            size,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (id != uuid::nil_uuid()) {
+            buffer.id = id;
+            g_ctx.dm.updateResourceRegistration(buffer);
+        } else {
+            handle = g_ctx.dm.registerResource(buffer, DescriptorType::Storage);
+        }
+    };
+    create(objectBuffer, objects, sizeof(Object::Param) * object_capacity, 0);
+    create(instanceBuffer, instances, sizeof(uint32_t) * slot_capacity, 0);
+    // at most one draw per level of each object, copied into culledIndirectBuffer before the occlusion culling
+    create(indirectBuffer, commands, sizeof(VkDrawIndexedIndirectCommand) * slot_capacity,
+           VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    create(boundsBuffer, objectBounds, sizeof(AABB) * object_capacity, 0);
+    create(slotBuffer, slots, sizeof(uint32_t) * slot_capacity, 0);
+    create(culledInstanceBuffer, culledInstances, sizeof(uint32_t) * slot_capacity, 0);
+    create(culledIndirectBuffer, culledCommands, sizeof(VkDrawIndexedIndirectCommand) * slot_capacity,
+           VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+}
+
+void SceneDraws::destroyObjectBuffers()
+{
+    // the writes still queued for these buffers would be copied into destroyed buffers,
+    // the buffers that replace them are written in full
+    for (auto buffer : { &objectBuffer, &instanceBuffer, &indirectBuffer, &boundsBuffer, &slotBuffer, &culledInstanceBuffer, &culledIndirectBuffer }) {
+        g_ctx.vk.uploader.discard(*buffer);
+    }
+    Buffer::Delete(g_ctx.vk, objectBuffer);
+    Buffer::Delete(g_ctx.vk, instanceBuffer);
+    Buffer::Delete(g_ctx.vk, indirectBuffer);
+    Buffer::Delete(g_ctx.vk, boundsBuffer);
+    Buffer::Delete(g_ctx.vk, slotBuffer);
+    Buffer::Delete(g_ctx.vk, culledInstanceBuffer);
+    Buffer::Delete(g_ctx.vk, culledIndirectBuffer);
+}
+
+void SceneDraws::writeObjects(const std::vector<Object>& objects, bool deferred)
+{
+    // sorted, so the order of the draws doesn't change from run to run
+    std::map<std::pair<std::string, DescriptorHandle>, std::vector<uint32_t>> groups;
+    std::vector<Object::Param> params;
+    params.reserve(objects.size());
+    bounds.clear();
+    bounds.reserve(objects.size());
+    object_meshes.clear();
+    object_meshes.reserve(objects.size());
+    object_scales.clear();
+    object_scales.reserve(objects.size());
+    for (uint32_t i = 0; i < objects.size(); i++) {
+        assert(objects[i].index == i);
+        const auto& mesh = g_ctx.rm->meshes.at(objects[i].mesh);
+        groups[{ objects[i].mesh, objects[i].param.material }].emplace_back(i);
+        params.emplace_back(objects[i].param);
+        bounds.emplace_back(mesh.bounds.transformed(objects[i].param.model));
+        object_meshes.emplace_back(&mesh);
+        object_scales.emplace_back(maxScale(objects[i].param.model));
+    }
+    bvh.build(bounds);
+    moved.clear();
+    object_lods.assign(objects.size(), 0);
+
+    batches.clear();
+    object_batches.resize(objects.size());
+    uint32_t first_instance = 0;
+    for (const auto& group : groups) {
+        const auto& mesh = g_ctx.rm->meshes.at(group.first.first);
+        for (auto object : group.second)
+            object_batches[object] = static_cast<uint32_t>(batches.size());
+
+        // any of the objects may be at any level
+        for (uint32_t lod = 0; lod < mesh.lodCount(); lod++) {
+            VkDrawIndexedIndirectCommand command {};
+            command.indexCount    = static_cast<uint32_t>(mesh.indices(lod).size());
+            command.instanceCount = static_cast<uint32_t>(group.second.size());
+            command.firstIndex    = lod == 0 ? mesh.firstIndex : mesh.lods[lod - 1].firstIndex;
+            command.vertexOffset  = mesh.vertexOffset;
+            command.firstInstance = first_instance;
+            batches.emplace_back(command);
+            first_instance += command.instanceCount;
+        }
+    }
+    drawCount = static_cast<uint32_t>(batches.size());
+
+    // the occlusion culling runs over all the slots
+    std::vector<uint32_t> slot_batches(slot_capacity, UINT32_MAX);
+    for (uint32_t i = 0; i < batches.size(); i++)
+        std::fill_n(slot_batches.begin() + batches[i].firstInstance, batches[i].instanceCount, i);
+
+    auto write = [&](Buffer& buffer, const void* data, size_t size) {
+        if (deferred)
+            buffer.UpdateDeferred(g_ctx.vk, data, size);
+        else
+            buffer.Update(g_ctx.vk, data, size);
+    };
+    write(slotBuffer, slot_batches.data(), sizeof(uint32_t) * slot_batches.size());
+    if (params.empty())
+        return;
+    write(objectBuffer, params.data(), sizeof(Object::Param) * params.size());
+    write(boundsBuffer, bounds.data(), sizeof(AABB) * bounds.size());
+}
+
+void SceneDraws::writeDraws(bool deferred)
+{
+    // in the order of the objects within a batch
+    std::sort(visible.begin(), visible.end());
+
+    std::vector<VkDrawIndexedIndirectCommand> commands = batches;
+    std::vector<uint32_t> instance_objects(batches.empty() ? 0 : batches.back().firstInstance + batches.back().instanceCount, 0);
+    for (auto& command : commands)
+        command.instanceCount = 0;
+    for (auto object : visible) {
+        auto& command = commands[object_batches[object] + object_lods[object]];
+        instance_objects[command.firstInstance + command.instanceCount++] = object;
+    }
+
+    // the commands are plain integers
+    bool same_commands = commands.size() == written_commands.size()
+        && std::memcmp(commands.data(), written_commands.data(), sizeof(VkDrawIndexedIndirectCommand) * commands.size()) == 0;
+    if (same_commands && instance_objects == written_instances)
+        return;
+    written_commands  = std::move(commands);
+    written_instances = std::move(instance_objects);
+    if (written_commands.empty())
+        return;
+
+    size_t instance_size = sizeof(uint32_t) * written_instances.size();
+    size_t command_size  = sizeof(VkDrawIndexedIndirectCommand) * written_commands.size();
+    if (deferred) {
+        instanceBuffer.UpdateDeferred(g_ctx.vk, written_instances.data(), instance_size);
+        indirectBuffer.UpdateDeferred(g_ctx.vk, written_commands.data(), command_size);
+    } else {
+        instanceBuffer.Update(g_ctx.vk, written_instances.data(), instance_size);
+        indirectBuffer.Update(g_ctx.vk, written_commands.data(), command_size);
+    }
+}
+
+void SceneDraws::update()
+{
+    // the fence of this frame slot is signaled
+    occlusion_drawn = static_cast<const uint32_t*>(readbackBuffer.mapped)[g_ctx.frameIndex()];
+
+    const auto& rm      = *g_ctx.rm;
+    const auto& camera  = rm.camera.data;
+    glm::mat4 view_proj = camera.proj * camera.view;
+    bool selecting      = lod_error > 0.0f;
+    bool changed        = !moved.empty() || culled != culling || lod_error != selected_lod_error
+        || (selecting && camera.height != selected_height)
+        || ((culling || selecting) && view_proj != culled_view_proj);
+
+    if (objects_version != rm.objects_version) {
+        objects_version = rm.objects_version;
+        if (rm.objects.size() > object_capacity) {
+            // the frames in flight still read the old buffers
+            vkDeviceWaitIdle(g_ctx.vk.device);
+            destroyObjectBuffers();
+            createObjectBuffers(static_cast<uint32_t>(rm.objects.size()) * 2);
+        }
+        writeObjects(rm.objects, true);
+        changed = true;
+    } else if (!moved.empty()) {
+        bvh.refit(moved, bounds);
+        if (bvh.degraded())
+            bvh.build(bounds);
+        moved.clear();
+    }
+    if (!changed)
+        return;
+
+    visible.clear();
+    if (culling) {
+        bvh.cull(Frustum::fromMatrix(view_proj), bounds, visible);
+    } else {
+        visible.resize(bounds.size());
+        std::iota(visible.begin(), visible.end(), 0);
+    }
+    culled           = culling;
+    culled_view_proj = view_proj;
+    selectLods(camera);
+    selected_lod_error = lod_error;
+    selected_height    = camera.height;
+    writeDraws(true);
+}
+
+void SceneDraws::selectLods(const CameraData& camera)
+{
+    // an error of one unit one unit away from the camera covers this many pixels
+    const float pixels = camera.height / (2.0f * std::tan(glm::radians(camera.fov_y) * 0.5f));
+    for (auto object : visible) {
+        const auto& lods = object_meshes[object]->lods;
+        uint32_t lod     = 0;
+        // at the nearest point of the bounding sphere, the full mesh inside it
+        glm::vec3 center = (bounds[object].bmin + bounds[object].bmax) * 0.5f;
+        float radius     = glm::length(bounds[object].bmax - bounds[object].bmin) * 0.5f;
+        float distance   = glm::length(center - camera.eye_w) - radius;
+        if (lod_error > 0.0f && distance > 0.0f) {
+            float scale = object_scales[object] * pixels / distance;
+            while (lod < lods.size() && lods[lod].error * scale <= lod_error)
+                lod++;
+        }
+        object_lods[object] = lod;
+    }
+}
+
+void SceneDraws::updateObject(const Object& object)
+{
+    // the objects being loaded are written by initObjects
+    if (object.index >= bounds.size() || objects_version != g_ctx.rm->objects_version)
+        return;
+    objectBuffer.UpdateDeferred(g_ctx.vk, &object.param, sizeof(Object::Param), sizeof(Object::Param) * object.index);
+
+    bounds[object.index]        = g_ctx.rm->meshes.at(object.mesh).bounds.transformed(object.param.model);
+    object_scales[object.index] = maxScale(object.param.model);
+    boundsBuffer.UpdateDeferred(g_ctx.vk, &bounds[object.index], sizeof(AABB), sizeof(AABB) * object.index);
+    moved.emplace_back(object.index);
+}
+
+void SceneDraws::draw(VkCommandBuffer commandBuffer) const
+{
+    if (drawCount == 0)
+        return;
+
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    VkBuffer indirect = occlusion ? culledIndirectBuffer.buffer : indirectBuffer.buffer;
+    if (g_ctx.vk.multiDrawIndirect) {
+        vkCmdDrawIndexedIndirect(commandBuffer, indirect, 0, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+    for (uint32_t i = 0; i < drawCount; i++) {
+        vkCmdDrawIndexedIndirect(commandBuffer, indirect, sizeof(VkDrawIndexedIndirectCommand) * i, 1,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+void SceneDraws::invalidatePyramid()
+{
+    PyramidInfo info {};
+    info.levels = DescriptorHandle::Null;
+    pyramidBuffer.Update(g_ctx.vk, &info, sizeof(PyramidInfo));
+}
+
+SceneDraws::Stats SceneDraws::stats() const
+{
+    Stats s;
+    s.objects = static_cast<uint32_t>(g_ctx.rm->objects.size());
+    s.visible = static_cast<uint32_t>(visible.size());
+    s.drawn   = occlusion ? std::min(occlusion_drawn, s.visible) : s.visible;
+    for (auto object : visible)
+        s.simplified += object_lods[object] != 0;
+    for (const auto& command : written_commands) {
+        s.triangles += static_cast<uint64_t>(command.instanceCount) * command.indexCount / 3;
+        s.draws += command.instanceCount != 0;
+    }
+    s.calls = drawCount == 0 ? 0 : (g_ctx.vk.multiDrawIndirect ? 1 : drawCount);
+    return s;
+}
+
+void SceneDraws::report() const
+{
+    auto s = stats();
+    INFO_ALL("scene draws: " + std::to_string(s.visible) + " of " + std::to_string(s.objects) + " objects visible"
+             + (occlusion ? " and occlusion culled on the gpu" : "") + " in "
+             + std::to_string(s.draws) + " instanced draws of " + std::to_string(s.triangles) + " triangles, "
+             + std::to_string(s.simplified) + " objects at a coarser level, "
+             + std::to_string(s.calls) + " vkCmdDrawIndexedIndirect per object pass");
+}
+
+void SceneDraws::destroy()
+{
+    Buffer::Delete(g_ctx.vk, vertexBuffer);
+    Buffer::Delete(g_ctx.vk, indexBuffer);
+    if (object_capacity != 0) {
+        destroyObjectBuffers();
+        Buffer::Delete(g_ctx.vk, pyramidBuffer);
+        Buffer::Delete(g_ctx.vk, counterBuffer);
+        Buffer::Delete(g_ctx.vk, readbackBuffer);
+    }
+}
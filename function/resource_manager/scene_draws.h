@@ -0,0 +1,130 @@
+#pragma once
+
+#include "core/vulkan/descriptor_manager.h"
+#include "core/vulkan/type/buffer.h"
+#include "function/tool/bvh.h"
+#include "function/type/camera.h"
+#include "function/type/mesh.h"
+#include "function/type/object.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The vertices and indices of all the meshes in two shared buffers and Object::Param of every object in a
+// storage buffer. The objects with the same mesh and material are one instanced VkDrawIndexedIndirectCommand,
+// so an object pass is one vkCmdDrawIndexedIndirect. The instance buffer holds the object indices of the
+// batches one after another, gl_InstanceIndex (firstInstance + the instance) indexes it in the shaders.
+// Before each frame the objects outside of the camera frustum are culled over a BVH of their world bounds,
+// a batch keeps its command and its range of the instance buffer, only its instanceCount shrinks.
+// Each mesh and material has a batch per level of detail of the mesh, all with a range for every object of the
+// group, and a visible object is put in the batch of the level its projected error allows.
+// With the OcclusionCull node in the graph, these instances and commands are culled again on the gpu against
+// the depth pyramid of the last frame into the culled buffers, which are the ones drawn
+class SceneDraws {
+    void createObjectBuffers(uint32_t capacity);
+    void destroyObjectBuffers();
+    // the params, batches and bounds of all the objects, through the frame uploader if deferred
+    void writeObjects(const std::vector<Object>& objects, bool deferred);
+    // the instances and commands of the visible objects, uploaded if they changed
+    void writeDraws(bool deferred);
+    // the coarsest level of each visible object whose error is under lod_error pixels
+    void selectLods(const CameraData& camera);
+
+    uint32_t object_capacity = 0;
+    uint32_t slot_capacity   = 0; // of the instance and command buffers, every level of every object
+    uint32_t objects_version = 0;
+
+    // of all the objects
+    std::vector<VkDrawIndexedIndirectCommand> batches;
+    std::vector<uint32_t> object_batches; // of the full mesh, the next levels follow
+    std::vector<const Mesh*> object_meshes;
+    std::vector<float> object_scales; // the largest scale of the model matrix
+    std::vector<uint32_t> object_lods;
+    // in the world space, moved are refit in the BVH before culling
+    std::vector<AABB> bounds;
+    std::vector<uint32_t> moved;
+    BVH bvh;
+
+    // what the buffers hold
+    std::vector<uint32_t> written_instances;
+    std::vector<VkDrawIndexedIndirectCommand> written_commands;
+    glm::mat4 culled_view_proj = glm::mat4(0.0f);
+    bool culled                = false;
+    float selected_lod_error   = 0.0f;
+    int selected_height        = 0;
+    std::vector<uint32_t> visible;
+    uint32_t occlusion_drawn = 0; // by the frame that used this frame slot before
+
+public:
+    struct Stats {
+        uint32_t objects    = 0;
+        uint32_t visible    = 0; // in the frustum
+        uint32_t drawn      = 0; // not occluded either
+        uint32_t simplified = 0; // visible at a coarser level than the full mesh
+        uint64_t triangles  = 0; // of the visible objects
+        uint32_t draws      = 0; // instanced draw commands
+        uint32_t calls      = 0; // vkCmdDrawIndexedIndirect per object pass
+    };
+
+    // written on the gpu by the DepthPyramid node, read by the OcclusionCull node of the next frame
+    struct PyramidInfo {
+        // of the camera the depth was rendered with
+        glm::mat4 view;
+        glm::mat4 proj;
+        glm::uvec2 depth_size;
+        Vk::DescriptorHandle levels; // the max depth of the levels one after another, floats
+        uint32_t valid; // 0 until a pyramid is built after init or a resize
+    };
+
+    Vk::Buffer vertexBuffer;
+    Vk::Buffer indexBuffer;
+    Vk::Buffer objectBuffer;
+    Vk::Buffer instanceBuffer;
+    Vk::Buffer indirectBuffer;
+    Vk::Buffer boundsBuffer; // AABB of each object in the world space
+    Vk::Buffer slotBuffer; // the batch of each slot of the instance buffer, UINT32_MAX past the objects
+    Vk::Buffer culledInstanceBuffer;
+    Vk::Buffer culledIndirectBuffer;
+    Vk::Buffer pyramidBuffer; // PyramidInfo
+    Vk::Buffer counterBuffer; // instances drawn after the occlusion culling
+    Vk::Buffer readbackBuffer; // counterBuffer of each frame slot
+    // of the storage buffers above, for the pipeline params
+    Vk::DescriptorHandle objects         = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle instances       = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle commands        = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle objectBounds    = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle slots           = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle culledInstances = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle culledCommands  = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle pyramid         = Vk::DescriptorHandle::Null;
+    Vk::DescriptorHandle counter         = Vk::DescriptorHandle::Null;
+    uint32_t drawCount                   = 0;
+    // against the frustum of ResourceManager::camera
+    bool culling = true;
+    // set by the OcclusionCull node when the graph is created
+    bool occlusion = false;
+    // the screen space error in pixels a level of detail may have, 0 draws the full meshes
+    float lod_error = 1.0f;
+
+    // sets the ranges of the meshes and their levels, their data is uploaded on the transfer queue
+    void initGeometry(std::unordered_map<std::string, Mesh>& meshes);
+    // after the objects are loaded
+    void initObjects(const std::vector<Object>& objects);
+    // writes the objects and commands again if ResourceManager::objects_version changed and culls them, before
+    // recording a frame
+    void update();
+    // applied at the beginning of the next recorded frame
+    void updateObject(const Object& object);
+    // binds the shared buffers and draws all the objects, the pipeline and descriptor sets are bound by the caller
+    void draw(VkCommandBuffer commandBuffer) const;
+    // the instances draw() reads, for the params of the object pipelines
+    Vk::DescriptorHandle drawnInstances() const { return occlusion ? culledInstances : instances; }
+    // slots of the instance buffers
+    uint32_t capacity() const { return slot_capacity; }
+    // the pyramid isn't used until it is built again
+    void invalidatePyramid();
+    Stats stats() const;
+    // logs the stats
+    void report() const;
+    void destroy();
+};
@@ -0,0 +1,191 @@
+#include "bvh.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+void BVH::build(const std::vector<AABB>& bounds)
+{
+    nodes.clear();
+    items.resize(bounds.size());
+    leaves.resize(bounds.size());
+    std::iota(items.begin(), items.end(), 0);
+    built_area = 0.0f;
+    if (bounds.empty())
+        return;
+
+    nodes.reserve(bounds.size() * 2);
+    nodes.emplace_back();
+    nodes[0].count = static_cast<uint32_t>(items.size());
+    refitNode(0, bounds);
+
+    std::vector<uint32_t> stack = { 0 };
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        if (split(node, bounds)) {
+            stack.emplace_back(nodes[node].first);
+            stack.emplace_back(nodes[node].first + 1);
+            continue;
+        }
+        for (uint32_t i = nodes[node].first; i < nodes[node].first + nodes[node].count; i++)
+            leaves[items[i]] = node;
+    }
+    built_area = nodes[0].bounds.area();
+}
+
+bool BVH::split(uint32_t node, const std::vector<AABB>& bounds)
+{
+    const uint32_t first = nodes[node].first;
+    const uint32_t count = nodes[node].count;
+    if (count <= MAX_LEAF_ITEMS)
+        return false;
+
+    AABB centroids = AABB::empty();
+    for (uint32_t i = first; i < first + count; i++)
+        centroids.expand(bounds[items[i]].center());
+    glm::vec3 extent = centroids.bmax - centroids.bmin;
+    int axis         = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    auto begin = items.begin() + first;
+    auto end   = begin + count;
+    uint32_t mid;
+    if (extent[axis] <= 0.0f) {
+        // the same centroid, split them in half so the leaves stay small
+        mid = count / 2;
+    } else {
+        auto bin_of = [&](uint32_t item) {
+            float t = (bounds[item].center()[axis] - centroids.bmin[axis]) / extent[axis];
+            return std::min(static_cast<uint32_t>(t * BIN_COUNT), BIN_COUNT - 1);
+        };
+
+        std::array<AABB, BIN_COUNT> bin_bounds;
+        std::array<uint32_t, BIN_COUNT> bin_counts {};
+        bin_bounds.fill(AABB::empty());
+        for (auto it = begin; it != end; it++) {
+            uint32_t bin = bin_of(*it);
+            bin_bounds[bin].expand(bounds[*it]);
+            bin_counts[bin]++;
+        }
+
+        // the area and count to the right of each plane between the bins
+        std::array<float, BIN_COUNT> right_areas {};
+        std::array<uint32_t, BIN_COUNT> right_counts {};
+        AABB right         = AABB::empty();
+        uint32_t right_sum = 0;
+        for (uint32_t i = BIN_COUNT - 1; i > 0; i--) {
+            right.expand(bin_bounds[i]);
+            right_sum += bin_counts[i];
+            right_areas[i]  = right.area();
+            right_counts[i] = right_sum;
+        }
+
+        float best_cost   = std::numeric_limits<float>::max();
+        uint32_t best_bin = 0;
+        AABB left         = AABB::empty();
+        uint32_t left_sum = 0;
+        for (uint32_t i = 1; i < BIN_COUNT; i++) {
+            left.expand(bin_bounds[i - 1]);
+            left_sum += bin_counts[i - 1];
+            if (left_sum == 0 || right_counts[i] == 0)
+                continue;
+            float cost = left.area() * left_sum + right_areas[i] * right_counts[i];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_bin  = i;
+            }
+        }
+
+        if (best_bin != 0) {
+            mid = static_cast<uint32_t>(std::partition(begin, end, [&](uint32_t item) { return bin_of(item) < best_bin; }) - begin);
+        } else {
+            mid = count / 2;
+            std::nth_element(begin, begin + mid, end, [&](uint32_t a, uint32_t b) {
+                return bounds[a].center()[axis] < bounds[b].center()[axis];
+            });
+        }
+    }
+
+    uint32_t left_node = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left_node].parent     = node;
+    nodes[left_node].first      = first;
+    nodes[left_node].count      = mid;
+    nodes[left_node + 1].parent = node;
+    nodes[left_node + 1].first  = first + mid;
+    nodes[left_node + 1].count  = count - mid;
+    refitNode(left_node, bounds);
+    refitNode(left_node + 1, bounds);
+
+    nodes[node].first = left_node;
+    nodes[node].count = 0;
+    return true;
+}
+
+void BVH::refitNode(uint32_t node, const std::vector<AABB>& bounds)
+{
+    Node& n  = nodes[node];
+    n.bounds = AABB::empty();
+    if (n.leaf()) {
+        for (uint32_t i = n.first; i < n.first + n.count; i++)
+            n.bounds.expand(bounds[items[i]]);
+    } else {
+        n.bounds.expand(nodes[n.first].bounds);
+        n.bounds.expand(nodes[n.first + 1].bounds);
+    }
+}
+
+void BVH::refit(const std::vector<uint32_t>& changed, const std::vector<AABB>& bounds)
+{
+    if (nodes.empty())
+        return;
+
+    // walking up from every item visits the upper nodes again and again
+    if (changed.size() * 4 > items.size()) {
+        for (size_t i = nodes.size(); i-- > 0;)
+            refitNode(static_cast<uint32_t>(i), bounds);
+        return;
+    }
+    for (auto item : changed) {
+        for (uint32_t node = leaves[item]; node != UINT32_MAX; node = nodes[node].parent)
+            refitNode(node, bounds);
+    }
+}
+
+bool BVH::degraded() const
+{
+    return !nodes.empty() && nodes[0].bounds.area() > 2.0f * built_area;
+}
+
+void BVH::cull(const Frustum& frustum, const std::vector<AABB>& bounds, std::vector<uint32_t>& visible) const
+{
+    if (nodes.empty())
+        return;
+
+    // with inside, the whole subtree is in the frustum
+    std::vector<std::pair<uint32_t, bool>> stack = { { 0, false } };
+    while (!stack.empty()) {
+        auto [node, inside] = stack.back();
+        stack.pop_back();
+        const Node& n = nodes[node];
+
+        if (!inside) {
+            auto test = frustum.test(n.bounds);
+            if (test == Frustum::Test::Outside)
+                continue;
+            inside = test == Frustum::Test::Inside;
+        }
+
+        if (!n.leaf()) {
+            stack.emplace_back(n.first, inside);
+            stack.emplace_back(n.first + 1, inside);
+            continue;
+        }
+        for (uint32_t i = n.first; i < n.first + n.count; i++) {
+            if (inside || frustum.test(bounds[items[i]]) != Frustum::Test::Outside)
+                visible.emplace_back(items[i]);
+        }
+    }
+}
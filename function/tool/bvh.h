@@ -0,0 +1,42 @@
+#pragma once
+
+#include "function/type/aabb.h"
+#include "function/type/frustum.h"
+#include <cstdint>
+#include <vector>
+
+// A binned SAH tree over the items of bounds, an item is the index of its box. Moving items refit the
+// boxes of their leaves up to the root, the tree is built again once it gets much looser than it was
+class BVH {
+    struct Node {
+        AABB bounds;
+        uint32_t parent = UINT32_MAX;
+        // the children of an inner node are first and first + 1, the items of a leaf are items[first, first + count)
+        uint32_t first = 0;
+        uint32_t count = 0;
+
+        bool leaf() const { return count != 0; }
+    };
+
+    static constexpr uint32_t BIN_COUNT      = 12;
+    static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+
+    // false if node stays a leaf
+    bool split(uint32_t node, const std::vector<AABB>& bounds);
+    void refitNode(uint32_t node, const std::vector<AABB>& bounds);
+
+    std::vector<Node> nodes; // the children come after their parents
+    std::vector<uint32_t> items;
+    std::vector<uint32_t> leaves; // of each item
+    float built_area = 0.0f;
+
+public:
+    void build(const std::vector<AABB>& bounds);
+    // the boxes of changed are updated in bounds
+    void refit(const std::vector<uint32_t>& changed, const std::vector<AABB>& bounds);
+    // refitting made the root much larger than it was built
+    bool degraded() const;
+    // appends the items whose boxes are not outside of frustum to visible
+    void cull(const Frustum& frustum, const std::vector<AABB>& bounds, std::vector<uint32_t>& visible) const;
+    size_t size() const { return items.size(); }
+};
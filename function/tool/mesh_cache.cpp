@@ -0,0 +1,210 @@
+#include "mesh_cache.h"
+#include "core/tool/hash.h"
+#include "core/tool/logger.h"
+#include "function/type/mesh.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+static_assert(sizeof(Vertex) % 4 == 0 && alignof(Vertex) <= 8);
+
+static size_t padded(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+// what is stored and compared, the same file through another relative path is the same
+static std::string normalized(const std::filesystem::path& source)
+{
+    return std::filesystem::absolute(source).lexically_normal().string();
+}
+
+void MeshCache::init(const std::filesystem::path& directory)
+{
+    this->directory = directory;
+}
+
+std::filesystem::path MeshCache::cachePath(const Key& key) const
+{
+    // the same source with other options is another file
+    StableHash hash;
+    hash.add(normalized(key.source));
+    hash.add(std::to_string(key.import_flags));
+    hash.add(std::to_string(key.options));
+    std::stringstream name;
+    name << key.source.stem().string() << "-" << std::hex << hash.value << ".mesh";
+    return directory / name.str();
+}
+
+bool MeshCache::load(const Key& key, Mesh& mesh)
+{
+    if (!enabled())
+        return false;
+    auto start         = std::chrono::steady_clock::now();
+    auto path          = cachePath(key);
+    std::string source = normalized(key.source);
+
+    auto miss = [&](const std::string& reason) {
+        misses++;
+        INFO_ALL("mesh cache: miss for " + key.source.string() + ", " + reason);
+        return false;
+    };
+
+    std::error_code ec;
+    auto source_size = std::filesystem::file_size(key.source, ec);
+    if (ec)
+        return miss("the source can't be read");
+    auto source_time = static_cast<int64_t>(std::filesystem::last_write_time(key.source, ec).time_since_epoch().count());
+    if (ec)
+        return miss("the source can't be read");
+    if (!std::filesystem::exists(path, ec))
+        return miss("not cached yet");
+
+    std::shared_ptr<boost::interprocess::mapped_region> region;
+    try {
+        boost::interprocess::file_mapping file(path.string().c_str(), boost::interprocess::read_only);
+        region = std::make_shared<boost::interprocess::mapped_region>(file, boost::interprocess::read_only);
+    } catch (const std::exception& e) {
+        return miss(std::string("failed to map ") + path.string() + ": " + e.what());
+    }
+    const char* data = static_cast<const char*>(region->get_address());
+    size_t size      = region->get_size();
+
+    FileHeader header {};
+    if (size < sizeof(FileHeader))
+        return miss(path.string() + " is truncated");
+    memcpy(&header, data, sizeof(FileHeader));
+    if (header.magic != MAGIC || header.version != VERSION || header.vertex_size != sizeof(Vertex))
+        return miss(path.string() + " is of another version");
+    if (header.import_flags != key.import_flags || header.options != key.options
+        || header.path_size != source.size() || size < sizeof(FileHeader) + header.path_size
+        || std::string_view(data + sizeof(FileHeader), header.path_size) != source)
+        return miss(path.string() + " is of another import");
+    if (header.source_size != source_size || header.source_time != source_time)
+        return miss("the source changed");
+
+    // more levels than a mesh may have would overflow the draw slots of SceneDraws
+    if (header.lod_count > Mesh::MAX_LODS - 1)
+        return miss(path.string() + " is corrupt");
+
+    // the counts are read from the file, each part must fit in the rest of it
+    size_t offset = sizeof(FileHeader) + padded(header.path_size);
+    size_t end    = offset;
+    auto fits     = [&](uint64_t count, size_t element_size) {
+        if (end > size || count > (size - end) / element_size)
+            return false;
+        end += count * element_size;
+        return true;
+    };
+    std::vector<LodHeader> lods(header.lod_count);
+    if (!fits(lods.size(), sizeof(LodHeader)))
+        return miss(path.string() + " is truncated");
+    memcpy(lods.data(), data + offset, sizeof(LodHeader) * lods.size());
+    bool complete = fits(header.vertex_count, sizeof(Vertex)) && fits(header.index_count, sizeof(uint32_t));
+    for (const auto& lod : lods)
+        complete = complete && fits(lod.index_count, sizeof(uint32_t));
+    if (!complete)
+        return miss(path.string() + " is truncated");
+    offset += sizeof(LodHeader) * lods.size();
+
+    // the offsets are multiples of 4 from a page aligned address
+    mesh.mapped_vertices = { reinterpret_cast<const Vertex*>(data + offset), header.vertex_count };
+    offset += sizeof(Vertex) * header.vertex_count;
+    mesh.mapped_indices.clear();
+    mesh.mapped_indices.emplace_back(reinterpret_cast<const uint32_t*>(data + offset), header.index_count);
+    offset += sizeof(uint32_t) * header.index_count;
+    mesh.lods.clear();
+    for (const auto& lod : lods) {
+        mesh.mapped_indices.emplace_back(reinterpret_cast<const uint32_t*>(data + offset), lod.index_count);
+        offset += sizeof(uint32_t) * lod.index_count;
+        mesh.lods.push_back(MeshLod { {}, lod.error });
+    }
+    mesh.bounds.bmin = glm::vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+    mesh.bounds.bmax = glm::vec3(header.bounds[3], header.bounds[4], header.bounds[5]);
+    mesh.mapping     = region;
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    hits++;
+    hit_ms += ms;
+    INFO_ALL("mesh cache: hit for " + key.source.string() + ", mapped " + std::to_string(size / 1024) + " KB in "
+             + std::to_string(ms) + "ms");
+    return true;
+}
+
+void MeshCache::store(const Key& key, const Mesh& mesh)
+{
+    if (!enabled())
+        return;
+    auto path          = cachePath(key);
+    std::string source = normalized(key.source);
+
+    FileHeader header {};
+    header.magic        = MAGIC;
+    header.version      = VERSION;
+    header.vertex_size  = sizeof(Vertex);
+    header.import_flags = key.import_flags;
+    header.options      = key.options;
+    header.path_size    = static_cast<uint32_t>(source.size());
+    header.vertex_count = mesh.vertices().size();
+    header.index_count  = mesh.indices(0).size();
+    header.lod_count    = static_cast<uint32_t>(mesh.lods.size());
+    header.bounds[0]    = mesh.bounds.bmin.x;
+    header.bounds[1]    = mesh.bounds.bmin.y;
+    header.bounds[2]    = mesh.bounds.bmin.z;
+    header.bounds[3]    = mesh.bounds.bmax.x;
+    header.bounds[4]    = mesh.bounds.bmax.y;
+    header.bounds[5]    = mesh.bounds.bmax.z;
+
+    std::vector<LodHeader> lods;
+    for (uint32_t i = 0; i < mesh.lods.size(); i++)
+        lods.push_back(LodHeader { mesh.indices(i + 1).size(), mesh.lods[i].error });
+
+    // another instance may be mapping it, so the file is replaced in one step. The temporary name
+    // is unique to the thread and the process, another one may be storing the same mesh
+    std::filesystem::path temporary;
+    try {
+        header.source_size = std::filesystem::file_size(key.source);
+        header.source_time = static_cast<int64_t>(std::filesystem::last_write_time(key.source).time_since_epoch().count());
+
+        std::filesystem::create_directories(directory);
+        temporary = path;
+        temporary += "." + std::to_string(std::hash<std::thread::id> {}(std::this_thread::get_id())) + "-"
+            + std::to_string(std::random_device {}()) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            const char zeros[8] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(source.data(), source.size());
+            file.write(zeros, padded(source.size()) - source.size());
+            file.write(reinterpret_cast<const char*>(lods.data()), sizeof(LodHeader) * lods.size());
+            file.write(reinterpret_cast<const char*>(mesh.vertices().data()), sizeof(Vertex) * mesh.vertices().size());
+            for (uint32_t lod = 0; lod < mesh.lodCount(); lod++)
+                file.write(reinterpret_cast<const char*>(mesh.indices(lod).data()), sizeof(uint32_t) * mesh.indices(lod).size());
+            file.close();
+            if (!file.good())
+                throw std::runtime_error("failed to write " + temporary.string());
+        }
+        std::filesystem::rename(temporary, path);
+    } catch (const std::exception& e) {
+        WARN_ALL(std::string("mesh cache: failed to write ") + path.string() + ": " + e.what());
+        std::error_code ec;
+        if (!temporary.empty())
+            std::filesystem::remove(temporary, ec);
+        return;
+    }
+    INFO_ALL("mesh cache: wrote " + key.source.string() + " to " + path.string());
+}
+
+void MeshCache::report() const
+{
+    if (!enabled())
+        return;
+    INFO_ALL("mesh cache: " + std::to_string(hits) + " hits in " + std::to_string(hit_ms) + "ms, "
+             + std::to_string(misses) + " misses");
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+struct Mesh;
+
+// Meshes imported from files kept on disk after the import, with their bounds and levels of detail, so a warm
+// start skips Assimp and the simplification. There is a file per source and options, used only if the path,
+// size and modification time of the source and the options in its header match. A hit maps the file and the
+// mesh points into it, the upload reads it from there.
+class MeshCache {
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertex_size;
+        uint32_t import_flags;
+        uint32_t options;
+        uint32_t path_size; // the source path follows the header, padded to 8 bytes
+        uint64_t source_size;
+        int64_t source_time;
+        uint64_t vertex_count;
+        uint64_t index_count;
+        uint32_t lod_count; // a LodHeader for each level after the path
+        uint32_t padding;
+        float bounds[6];
+    };
+
+    struct LodHeader {
+        uint64_t index_count;
+        float error;
+        uint32_t padding;
+    };
+
+    std::filesystem::path directory;
+    uint32_t hits = 0, misses = 0;
+    float hit_ms = 0.0f;
+
+    static constexpr uint32_t MAGIC   = 0x4853454d; // "MESH"
+    static constexpr uint32_t VERSION = 1;
+
+public:
+    // what else than the source changes the mesh
+    struct Key {
+        std::filesystem::path source;
+        uint32_t import_flags = 0; // of Assimp
+        uint32_t options      = 0; // of Mesh
+    };
+
+    // an empty directory turns the cache off
+    void init(const std::filesystem::path& directory);
+    bool enabled() const { return !directory.empty(); }
+    // false on a miss, mesh is untouched then
+    bool load(const Key& key, Mesh& mesh);
+    // after a miss, a failed write is only logged
+    void store(const Key& key, const Mesh& mesh);
+    // logs the hits and misses so far
+    void report() const;
+
+private:
+    std::filesystem::path cachePath(const Key& key) const;
+};
@@ -0,0 +1,263 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+// the LRU cache the scores are for, larger than the real one
+constexpr uint32_t SCORE_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER   = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+float vertexScore(int32_t cache_position, uint32_t remaining)
+{
+    // no triangles left to draw
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        // the triangle just drawn, whatever is drawn next uses these anyway
+        if (cache_position < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float scaler = 1.0f / (SCORE_CACHE_SIZE - 3);
+            score              = std::pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+    // the vertices with few triangles left go first, so no lone triangles are left behind
+    return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+}
+
+// true on a miss
+bool fifoAccess(std::vector<uint32_t>& timestamps, uint32_t& timestamp, uint32_t cache_size, uint32_t vertex)
+{
+    if (timestamp - timestamps[vertex] <= cache_size)
+        return false;
+    timestamps[vertex] = ++timestamp;
+    return true;
+}
+} // namespace
+
+MeshOptimizer::Stats MeshOptimizer::analyze(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size)
+{
+    Stats stats;
+    if (indices.empty())
+        return stats;
+
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    std::vector<bool> used(vertex_count, false);
+    uint32_t timestamp = cache_size + 1;
+    size_t misses = 0, unique = 0;
+    for (auto index : indices) {
+        misses += fifoAccess(timestamps, timestamp, cache_size, index);
+        unique += !used[index];
+        used[index] = true;
+    }
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / unique;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // the triangles of each vertex
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (auto index : indices)
+        offsets[index + 1]++;
+    for (size_t i = 1; i <= vertex_count; i++)
+        offsets[i] += offsets[i - 1];
+    std::vector<uint32_t> remaining(vertex_count);
+    for (size_t i = 0; i < vertex_count; i++)
+        remaining[i] = offsets[i + 1] - offsets[i];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        auto fill = offsets;
+        for (uint32_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<int32_t> cache_positions(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t i = 0; i < vertex_count; i++)
+        vertex_scores[i] = vertexScore(-1, remaining[i]);
+    std::vector<float> triangle_scores(triangle_count);
+    for (size_t t = 0; t < triangle_count; t++)
+        triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache, next_cache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    next_cache.reserve(SCORE_CACHE_SIZE + 3);
+
+    // the first triangle not emitted, for when the cache has nothing left to draw
+    size_t cursor = 0;
+    auto best     = static_cast<size_t>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    while (true) {
+        if (best == SIZE_MAX) {
+            while (cursor < triangle_count && emitted[cursor])
+                cursor++;
+            if (cursor == triangle_count)
+                break;
+            best = cursor;
+        }
+
+        emitted[best] = true;
+        const uint32_t* triangle = &indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // the vertices of the triangle to the front of the cache
+        next_cache.assign(triangle, triangle + 3);
+        for (auto vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                next_cache.push_back(vertex);
+        }
+        for (size_t i = SCORE_CACHE_SIZE; i < next_cache.size(); i++)
+            cache_positions[next_cache[i]] = -1;
+        next_cache.resize(std::min<size_t>(next_cache.size(), SCORE_CACHE_SIZE));
+        std::swap(cache, next_cache);
+
+        for (int c = 0; c < 3; c++) {
+            auto vertex = triangle[c];
+            auto begin  = adjacency.begin() + offsets[vertex];
+            auto end    = begin + remaining[vertex];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best)), end - 1);
+            remaining[vertex]--;
+        }
+
+        // the scores change only around the cache
+        for (uint32_t i = 0; i < cache.size(); i++) {
+            auto vertex             = cache[i];
+            cache_positions[vertex] = static_cast<int32_t>(i);
+            float score             = vertexScore(cache_positions[vertex], remaining[vertex]);
+            float delta             = score - vertex_scores[vertex];
+            vertex_scores[vertex]   = score;
+            for (uint32_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+                triangle_scores[adjacency[a]] += delta;
+        }
+        for (auto vertex : next_cache) {
+            if (cache_positions[vertex] != -1)
+                continue;
+            float score           = vertexScore(-1, remaining[vertex]);
+            float delta           = score - vertex_scores[vertex];
+            vertex_scores[vertex] = score;
+            for (uint32_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+                triangle_scores[adjacency[a]] += delta;
+        }
+
+        best             = SIZE_MAX;
+        float best_score = -1.0f;
+        for (auto vertex : cache) {
+            for (uint32_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++) {
+                if (triangle_scores[adjacency[a]] > best_score) {
+                    best_score = triangle_scores[adjacency[a]];
+                    best       = adjacency[a];
+                }
+            }
+        }
+    }
+    indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+    static constexpr uint32_t CACHE_SIZE = 16;
+    const size_t triangle_count          = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // a cluster starts where the cache starts over, a triangle with 3 misses, then where its hits get close
+    // enough to the hits of the whole run that cutting there costs little
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t timestamp = CACHE_SIZE + 1;
+    auto misses        = [&](size_t t) {
+        return fifoAccess(timestamps, timestamp, CACHE_SIZE, indices[t * 3])
+            + fifoAccess(timestamps, timestamp, CACHE_SIZE, indices[t * 3 + 1])
+            + fifoAccess(timestamps, timestamp, CACHE_SIZE, indices[t * 3 + 2]);
+    };
+    std::vector<size_t> hard = { 0 };
+    misses(0);
+    for (size_t t = 1; t < triangle_count; t++) {
+        if (misses(t) == 3)
+            hard.push_back(t);
+    }
+    hard.push_back(triangle_count);
+
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t begin = hard[h], end = hard[h + 1];
+        timestamp += CACHE_SIZE + 1;
+        size_t run_misses = 0;
+        for (size_t t = begin; t < end; t++)
+            run_misses += misses(t);
+        const float target = threshold * run_misses / (end - begin);
+
+        clusters.push_back(begin);
+        timestamp += CACHE_SIZE + 1;
+        size_t cluster_misses = 0, cluster_triangles = 0;
+        for (size_t t = begin; t < end; t++) {
+            cluster_misses += misses(t);
+            cluster_triangles++;
+            if (static_cast<float>(cluster_misses) / cluster_triangles <= target && t + 1 < end) {
+                clusters.push_back(t + 1);
+                timestamp += CACHE_SIZE + 1;
+                cluster_misses = cluster_triangles = 0;
+            }
+        }
+        // the rest after the last cut is usually a triangle or two
+        if (cluster_triangles != 0 && clusters.back() != begin && cluster_triangles < 3)
+            clusters.pop_back();
+    }
+    clusters.push_back(triangle_count);
+
+    // the clusters facing out from the center are drawn first, they cover the others more often than not
+    glm::vec3 center(0.0f);
+    for (auto index : indices)
+        center += vertices[index].pos;
+    center /= static_cast<float>(indices.size());
+    std::vector<float> keys(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const auto& p0 = vertices[indices[t * 3]].pos;
+            const auto& p1 = vertices[indices[t * 3 + 1]].pos;
+            const auto& p2 = vertices[indices[t * 3 + 2]].pos;
+            glm::vec3 n    = glm::cross(p1 - p0, p2 - p0);
+            float a        = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        float length = glm::length(normal);
+        keys[c]      = area > 0.0f && length > 0.0f ? glm::dot(centroid / area - center, normal / length) : 0.0f;
+    }
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices = std::move(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::vertexFetchRemap(const std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+    uint32_t next = 0;
+    for (auto index : indices) {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = next++;
+    }
+    return remap;
+}
@@ -0,0 +1,256 @@
+#include "mesh_simplifier.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+void MeshSimplifier::Quadric::add(const Quadric& other)
+{
+    for (int i = 0; i < 10; i++)
+        m[i] += other.m[i];
+    weight += other.weight;
+}
+
+void MeshSimplifier::Quadric::addPlane(const glm::dvec3& normal, double d, double w)
+{
+    const double a = normal.x, b = normal.y, c = normal.z;
+
+    m[0] += w * a * a;
+    m[1] += w * a * b;
+    m[2] += w * a * c;
+    m[3] += w * a * d;
+    m[4] += w * b * b;
+    m[5] += w * b * c;
+    m[6] += w * b * d;
+    m[7] += w * c * c;
+    m[8] += w * c * d;
+    m[9] += w * d * d;
+    weight += w;
+}
+
+double MeshSimplifier::Quadric::error(const glm::dvec3& p) const
+{
+    if (weight <= 0.0)
+        return 0.0;
+    const double x = p.x, y = p.y, z = p.z;
+
+    double e = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+             + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+             + m[7] * z * z + 2 * m[8] * z
+             + m[9];
+    return std::max(e, 0.0) / weight;
+}
+
+namespace {
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+inline uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// the first vertex with the same key
+template <typename Key>
+std::vector<uint32_t> weld(size_t count, Key key)
+{
+    std::vector<uint32_t> remap(count);
+    std::unordered_map<std::string_view, uint32_t> first;
+    first.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+        remap[i] = first.emplace(key(i), i).first->second;
+    return remap;
+}
+
+inline std::string_view bytes(const void* data, size_t size)
+{
+    return std::string_view(static_cast<const char*>(data), size);
+}
+} // namespace
+
+MeshSimplifier::Result MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                                size_t target_index_count, float max_error)
+{
+    Result result;
+    // meshes from files repeat a vertex for each face it's on, the same vertices are joined first
+    const auto same_vertex = weld(vertices.size(), [&](uint32_t i) { return bytes(&vertices[i], sizeof(Vertex)); });
+    const auto position    = weld(vertices.size(), [&](uint32_t i) { return bytes(&vertices[i].pos, sizeof(glm::vec3)); });
+
+    result.indices.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        uint32_t tri[3] = { same_vertex[indices[t]], same_vertex[indices[t + 1]], same_vertex[indices[t + 2]] };
+        if (position[tri[0]] != position[tri[1]] && position[tri[1]] != position[tri[2]] && position[tri[2]] != position[tri[0]])
+            result.indices.insert(result.indices.end(), tri, tri + 3);
+    }
+
+    // a position with more than one vertex is on a seam, one with an open or shared edge is on a border
+    std::vector<uint32_t> wedge(vertices.size(), UINT32_MAX);
+    std::vector<bool> locked(vertices.size(), false);
+    for (auto index : result.indices) {
+        auto p = position[index];
+        if (wedge[p] == UINT32_MAX)
+            wedge[p] = index;
+        else if (wedge[p] != index)
+            locked[p] = true;
+    }
+    {
+        std::unordered_map<uint64_t, uint32_t> edges;
+        edges.reserve(result.indices.size());
+        for (size_t t = 0; t < result.indices.size(); t += 3)
+            for (int e = 0; e < 3; e++)
+                edges[edgeKey(position[result.indices[t + e]], position[result.indices[t + (e + 1) % 3]])]++;
+        for (const auto& [key, count] : edges) {
+            auto a = static_cast<uint32_t>(key >> 32), b = static_cast<uint32_t>(key);
+            auto twin = edges.find(edgeKey(b, a));
+            if (count != 1 || twin == edges.end() || twin->second != 1)
+                locked[a] = locked[b] = true;
+        }
+    }
+
+    // the planes of the triangles around a position, weighted by area
+    auto point = [&](uint32_t p) { return glm::dvec3(vertices[p].pos); };
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t t = 0; t < result.indices.size(); t += 3) {
+        uint32_t p[3] = { position[result.indices[t]], position[result.indices[t + 1]], position[result.indices[t + 2]] };
+        glm::dvec3 n  = glm::cross(point(p[1]) - point(p[0]), point(p[2]) - point(p[0]));
+        double area   = glm::length(n);
+        if (area <= 0.0)
+            continue;
+        n /= area;
+        for (auto v : p)
+            quadrics[v].addPlane(n, -glm::dot(n, point(p[0])), area * 0.5);
+    }
+
+    const double max_cost = static_cast<double>(max_error) * max_error;
+    double worst          = 0.0;
+    std::vector<uint32_t> moved_to(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    std::vector<uint32_t> adjacency_offsets(vertices.size() + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> opposite, from_ring;
+
+    // in passes, the cheapest collapses of a pass go first and a position moves at most once per pass
+    while (result.indices.size() > target_index_count) {
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for (auto index : result.indices)
+            adjacency_offsets[position[index] + 1]++;
+        for (size_t i = 1; i < adjacency_offsets.size(); i++)
+            adjacency_offsets[i] += adjacency_offsets[i - 1];
+        adjacency.resize(result.indices.size());
+        {
+            auto fill = adjacency_offsets;
+            for (uint32_t i = 0; i < result.indices.size(); i++)
+                adjacency[fill[position[result.indices[i]]]++] = i / 3;
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.indices.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                auto from = position[result.indices[t + e]];
+                auto to   = position[result.indices[t + (e + 1) % 3]];
+                // the twin of the half edge has the same candidates, the open edges have none
+                if (from > to)
+                    continue;
+                for (int dir = 0; dir < 2; dir++, std::swap(from, to)) {
+                    if (locked[from])
+                        continue;
+                    Quadric q = quadrics[from];
+                    q.add(quadrics[to]);
+                    double cost = q.error(point(to));
+                    if (cost <= max_cost)
+                        collapses.push_back({ from, to, cost });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        for (size_t i = 0; i < moved_to.size(); i++)
+            moved_to[i] = static_cast<uint32_t>(i);
+        std::fill(touched.begin(), touched.end(), false);
+
+        const size_t triangles = result.indices.size() / 3;
+        const size_t target    = target_index_count / 3;
+        size_t removed         = 0;
+        for (const auto& collapse : collapses) {
+            if (triangles - removed <= target)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // the triangles on the edge go away, the others must keep facing the same side
+            // and the two ends must not share neighbours other than the ones across the edge
+            bool valid         = true;
+            size_t on_edge     = 0;
+            uint32_t to_vertex = UINT32_MAX;
+            opposite.clear();
+            from_ring.clear();
+            for (auto a = adjacency_offsets[collapse.from]; valid && a < adjacency_offsets[collapse.from + 1]; a++) {
+                const uint32_t* tri = &result.indices[adjacency[a] * 3];
+                uint32_t p[3]       = { moved_to[position[tri[0]]], moved_to[position[tri[1]]], moved_to[position[tri[2]]] };
+                int corner          = p[0] == collapse.from ? 0 : p[1] == collapse.from ? 1 : 2;
+                uint32_t p1 = p[(corner + 1) % 3], p2 = p[(corner + 2) % 3];
+                if (p1 == p2)
+                    continue;
+                if (p1 == collapse.to || p2 == collapse.to) {
+                    auto v = tri[p1 == collapse.to ? (corner + 1) % 3 : (corner + 2) % 3];
+                    valid  = to_vertex == UINT32_MAX || to_vertex == v;
+                    to_vertex = v;
+                    opposite.push_back(p1 == collapse.to ? p2 : p1);
+                    on_edge++;
+                    continue;
+                }
+                from_ring.push_back(p1);
+                from_ring.push_back(p2);
+
+                glm::dvec3 before = glm::cross(point(p1) - point(collapse.from), point(p2) - point(collapse.from));
+                glm::dvec3 after  = glm::cross(point(p1) - point(collapse.to), point(p2) - point(collapse.to));
+                valid             = glm::dot(before, after) > 0.25 * glm::length(before) * glm::length(after);
+            }
+            if (!valid || on_edge == 0)
+                continue;
+            for (auto a = adjacency_offsets[collapse.to]; valid && a < adjacency_offsets[collapse.to + 1]; a++) {
+                const uint32_t* tri = &result.indices[adjacency[a] * 3];
+                for (int c = 0; valid && c < 3; c++) {
+                    auto p = moved_to[position[tri[c]]];
+                    valid  = p == collapse.from || std::find(opposite.begin(), opposite.end(), p) != opposite.end()
+                        || std::find(from_ring.begin(), from_ring.end(), p) == from_ring.end();
+                }
+            }
+            if (!valid)
+                continue;
+
+            moved_to[collapse.from]   = collapse.to;
+            wedge[collapse.from]      = to_vertex;
+            touched[collapse.from]    = true;
+            touched[collapse.to]      = true;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            worst = std::max(worst, collapse.cost);
+            removed += on_edge;
+        }
+        if (removed == 0)
+            break;
+
+        // a moved position has one vertex, it becomes the vertex of the other end on the removed triangles
+        size_t kept = 0;
+        for (size_t t = 0; t < result.indices.size(); t += 3) {
+            uint32_t tri[3];
+            for (int c = 0; c < 3; c++) {
+                auto p = position[result.indices[t + c]];
+                tri[c] = moved_to[p] != p ? wedge[p] : result.indices[t + c];
+            }
+            if (position[tri[0]] == position[tri[1]] || position[tri[1]] == position[tri[2]] || position[tri[2]] == position[tri[0]])
+                continue;
+            std::memcpy(&result.indices[kept], tri, sizeof(tri));
+            kept += 3;
+        }
+        result.indices.resize(kept);
+    }
+
+    result.error = static_cast<float>(std::sqrt(worst));
+    return result;
+}
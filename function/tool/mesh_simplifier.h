@@ -0,0 +1,33 @@
+#pragma once
+
+#include "function/type/vertex.h"
+#include <cstdint>
+#include <vector>
+
+// Quadric error edge collapse (Garland and Heckbert) over an index buffer. The vertices are kept, a collapse moves
+// one vertex onto a neighbour, so the simplified indices index the same vertex buffer. Vertices where the normal
+// or uv is split and vertices on open edges never move, the seams and borders stay where they are
+class MeshSimplifier {
+    struct Quadric {
+        // the upper triangle of the symmetric 4x4 matrix, summed plane * plane^T scaled by the weight
+        double m[10] = {};
+        double weight = 0.0;
+
+        void add(const Quadric& other);
+        void addPlane(const glm::dvec3& normal, double d, double weight);
+        // the weighted mean squared distance of p to the planes
+        double error(const glm::dvec3& p) const;
+    };
+
+public:
+    struct Result {
+        std::vector<uint32_t> indices;
+        // the largest RMS distance of a moved vertex from the planes of the triangles merged into it
+        float error = 0.0f;
+    };
+
+    // collapses the cheapest edges first until the indices are down to target_index_count, or no collapse is
+    // left under max_error
+    static Result simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                           size_t target_index_count, float max_error);
+};
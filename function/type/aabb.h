@@ -1,10 +1,52 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <limits>
 
 struct AABB {
     glm::vec3 bmin;
     float padding0;
     glm::vec3 bmax;
     float padding1;
+
+    // expanding it by anything gives that thing
+    static AABB empty()
+    {
+        return AABB { .bmin = glm::vec3(std::numeric_limits<float>::max()),
+                      .bmax = glm::vec3(std::numeric_limits<float>::lowest()) };
+    }
+
+    bool valid() const { return bmin.x <= bmax.x && bmin.y <= bmax.y && bmin.z <= bmax.z; }
+    glm::vec3 center() const { return (bmin + bmax) * 0.5f; }
+
+    float area() const
+    {
+        if (!valid())
+            return 0.0f;
+        glm::vec3 d = bmax - bmin;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    void expand(const glm::vec3& p)
+    {
+        bmin = glm::min(bmin, p);
+        bmax = glm::max(bmax, p);
+    }
+
+    void expand(const AABB& other)
+    {
+        bmin = glm::min(bmin, other.bmin);
+        bmax = glm::max(bmax, other.bmax);
+    }
+
+    // the box around the transformed box
+    AABB transformed(const glm::mat4& m) const
+    {
+        if (!valid())
+            return *this;
+        glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        glm::mat3 a = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+        glm::vec3 e = a * ((bmax - bmin) * 0.5f);
+        return AABB { .bmin = c - e, .bmax = c + e };
+    }
 };
@@ -23,21 +23,21 @@ void Camera::update_position(const glm::vec3& position)
     glm::vec3 center = position + data.view_dir;
     data.eye_w       = position;
     data.view        = glm::lookAt(position, center, data.up);
-    buffer.Update(g_ctx.vk, &data, sizeof(CameraData));
+    buffer.UpdateDeferred(g_ctx.vk, &data, sizeof(CameraData));
 }
 
 void Camera::update_view_dir(const glm::vec3& view_dir)
 {
     data.view_dir = glm::normalize(view_dir);
     data.view     = glm::lookAt(data.eye_w, data.eye_w + data.view_dir, data.up);
-    buffer.Update(g_ctx.vk, &data, sizeof(CameraData));
+    buffer.UpdateDeferred(g_ctx.vk, &data, sizeof(CameraData));
 }
 
 void Camera::update_up(const glm::vec3& up)
 {
     data.view = glm::lookAt(data.eye_w, data.eye_w + data.view_dir, up);
     data.up   = up;
-    buffer.Update(g_ctx.vk, &data, sizeof(CameraData));
+    buffer.UpdateDeferred(g_ctx.vk, &data, sizeof(CameraData));
 }
 
 void Camera::update_fov(const float fov)
@@ -47,7 +47,7 @@ void Camera::update_fov(const float fov)
                                  0.1f, 100.0f);
     data.proj[1][1] *= -1;
     data.fov_y = fov;
-    buffer.Update(g_ctx.vk, &data, sizeof(CameraData));
+    buffer.UpdateDeferred(g_ctx.vk, &data, sizeof(CameraData));
 }
 
 void Camera::update_aspect_ratio(const uint32_t width, const uint32_t height)
@@ -57,7 +57,7 @@ void Camera::update_aspect_ratio(const uint32_t width, const uint32_t height)
     data.aspect_ratio = width / (float)height;
     data.width        = width;
     data.height       = height;
-    buffer.Update(g_ctx.vk, &data, sizeof(CameraData));
+    buffer.UpdateDeferred(g_ctx.vk, &data, sizeof(CameraData));
 }
 
 void Camera::update_rotation(const float dx, const float dy)
@@ -162,10 +162,9 @@ Camera Camera::fromConfiguration(CameraConfiguration& config)
     camera.buffer = Vk::Buffer::New(
         g_ctx.vk,
         sizeof(CameraData),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
-    camera.buffer.Update(g_ctx.vk, &camera.data, sizeof(CameraData));
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    camera.buffer.UpdateDeferred(g_ctx.vk, &camera.data, sizeof(CameraData));
     g_ctx.dm.registerResource(camera.buffer, DescriptorType::Uniform);
 
     return camera;
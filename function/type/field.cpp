@@ -33,7 +33,7 @@ Fields& Fields::operator=(Fields&& f) noexcept
     if (this != &f) {
         this->fields      = std::move(f.fields);
         this->step        = std::move(f.step);
-        this->paramBuffer = std::move(f.paramBuffer);
+        this->paramBlock  = std::move(f.paramBlock);
 
         this->has_temperature          = std::move(f.has_temperature);
         this->lights_dim               = std::move(f.lights_dim);
@@ -47,8 +47,11 @@ Fields& Fields::operator=(Fields&& f) noexcept
 
 void Field::destroy()
 {
+    g_ctx.vk.transfer.wait(pending_update);
     Buffer::Delete(g_ctx.vk, attr_buf);
     Image::Delete(g_ctx.vk, field_img);
+    if (upload_buf.size != 0)
+        Buffer::Delete(g_ctx.vk, upload_buf);
 }
 
 void Field::init(const FieldConfiguration& cfg)
@@ -111,14 +114,34 @@ void Field::initFieldImage(const FieldConfiguration& cfg)
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_TYPE_3D,
         VK_IMAGE_VIEW_TYPE_3D);
-    field_img.Update(g_ctx.vk, image_data.data());
+    field_img.UpdateAsync(g_ctx.vk, image_data.data(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     field_img.AddDefaultSampler(g_ctx.vk);
-    field_img.TransitionLayoutSingleTime(g_ctx.vk, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 void Field::updateFieldImage(const std::vector<float>& data)
 {
-    field_img.Update(g_ctx.vk, data.data());
+    const auto& extent = field_img.extent;
+    size_t size        = sizeof(float) * extent.width * extent.height * extent.depth;
+    assert(data.size() * sizeof(float) == size);
+
+    // the frames keep sampling the image while the data goes to upload_buf on the transfer queue,
+    // then it's copied into the image on the graphics queue before the next frame
+    g_ctx.vk.transfer.wait(pending_update); // upload_buf is still read
+    if (upload_buf.size == 0) {
+        upload_buf = Buffer::New(
+            g_ctx.vk,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    VkBuffer buffer      = upload_buf.buffer;
+    VkImage image        = field_img.image;
+    VkFormat format      = field_img.format;
+    VkImageLayout layout = field_img.layout;
+    pending_update       = upload_buf.UpdateAsync(g_ctx.vk, data.data(), size, 0, [=](VkCommandBuffer commandBuffer) {
+        copyBufferToImage(commandBuffer, buffer, image, layout, format, extent);
+    });
 }
 
 void SelfIlluminationLights::destroy()
@@ -144,7 +167,7 @@ void Fields::destroy()
     for (auto& field : fields) {
         field.destroy();
     }
-    Buffer::Delete(g_ctx.vk, paramBuffer);
+    g_ctx.dm.removeParameter(paramBlock);
 
     if (has_temperature) {
         lights.destroy();
@@ -193,9 +216,8 @@ void Fields::initFireLights(FieldsConfiguration& cfg)
     lights.buffer = Buffer::New(
         g_ctx.vk,
         total_num * sizeof(LightData),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     lights.update(lights.data.data(), 0, total_num);
     g_ctx.dm.registerResource(lights.buffer, DescriptorType::Storage);
 }
@@ -280,14 +302,8 @@ Fields Fields::fromConfiguration(FieldsConfiguration& cfg)
         fields.param.img[i * 4]
             = g_ctx.dm.getResourceHandle(fields.fields[i].field_img.id);
     }
-    fields.paramBuffer = Buffer::New(
-        g_ctx.vk,
-        sizeof(Param),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
-    fields.paramBuffer.Update(g_ctx.vk, &fields.param, sizeof(Param));
-    g_ctx.dm.registerParameter(fields.paramBuffer);
+    fields.paramBlock = g_ctx.dm.allocateParameter(sizeof(Param));
+    g_ctx.dm.updateParameter(fields.paramBlock, &fields.param, sizeof(Param));
 
     return fields;
 }
@@ -306,7 +322,7 @@ HANDLE Fields::getVkFieldMemHandle(int index)
     HANDLE handle;
     VkMemoryGetWin32HandleInfoKHR vkMemoryGetWin32HandleInfoKHR = {};
     vkMemoryGetWin32HandleInfoKHR.sType                         = VK_STRUCTURE_TYPE_MEMORY_GET_WIN32_HANDLE_INFO_KHR;
-    vkMemoryGetWin32HandleInfoKHR.memory                        = fields[index].field_img.memory;
+    vkMemoryGetWin32HandleInfoKHR.memory                        = fields[index].field_img.allocation.memory;
     vkMemoryGetWin32HandleInfoKHR.handleType                    = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT;
 
     fpGetMemoryWin32Handle(g_ctx.vk.device, &vkMemoryGetWin32HandleInfoKHR, &handle);
@@ -320,7 +336,7 @@ HANDLE Fields::getVkFieldMemHandle(const std::string& field_name)
     vkMemoryGetWin32HandleInfoKHR.sType                         = VK_STRUCTURE_TYPE_MEMORY_GET_WIN32_HANDLE_INFO_KHR;
     for (const auto& field : fields) {
         if (field.name == field_name) {
-            vkMemoryGetWin32HandleInfoKHR.memory = field.field_img.memory;
+            vkMemoryGetWin32HandleInfoKHR.memory = field.field_img.allocation.memory;
             break;
         }
     }
@@ -335,7 +351,7 @@ int Fields::getVkFieldMemHandle(int index)
     int fd;
     VkMemoryGetFdInfoKHR vkMemoryGetFdInfoKHR = {};
     vkMemoryGetFdInfoKHR.sType                = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
-    vkMemoryGetFdInfoKHR.memory               = fields[index].field_img.memory;
+    vkMemoryGetFdInfoKHR.memory               = fields[index].field_img.allocation.memory;
     vkMemoryGetFdInfoKHR.handleType           = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
 
     fpGetMemoryFdKHR(g_ctx.vk.device, &vkMemoryGetFdInfoKHR, &fd);
@@ -349,7 +365,7 @@ int Fields::getVkFieldMemHandle(const std::string& field_name)
     vkMemoryGetFdInfoKHR.sType                = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
     for (const auto& field : fields) {
         if (field.name == field_name) {
-            vkMemoryGetFdInfoKHR.memory = field.field_img.memory;
+            vkMemoryGetFdInfoKHR.memory = field.field_img.allocation.memory;
             break;
         }
     }
@@ -40,6 +40,9 @@ struct Field {
     Vk::Buffer attr_buf;
 
     Vk::Image field_img;
+    // updateFieldImage goes through it
+    Vk::Buffer upload_buf;
+    Vk::UploadTicket pending_update;
 
     void destroy();
     void init(const FieldConfiguration& cfg);
@@ -77,7 +80,7 @@ struct Fields {
 
     std::vector<Field> fields;
     Param param;
-    Vk::Buffer paramBuffer;
+    Vk::ParameterBlock paramBlock;
     float step;
 
     // pipelines/render graph can use these
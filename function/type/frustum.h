@@ -0,0 +1,48 @@
+#pragma once
+
+#include "aabb.h"
+#include <glm/glm.hpp>
+
+struct Frustum {
+    enum class Test {
+        Outside,
+        Intersect,
+        Inside,
+    };
+
+    // xyz is the normal pointing inside, a point p is in front of the plane if dot(xyz, p) + w >= 0
+    glm::vec4 planes[6];
+
+    // the planes of the clip space of view_proj, with the -w <= z <= w depth of glm::perspective
+    static Frustum fromMatrix(const glm::mat4& view_proj)
+    {
+        glm::mat4 m = glm::transpose(view_proj);
+        Frustum frustum;
+        frustum.planes[0] = m[3] + m[0];
+        frustum.planes[1] = m[3] - m[0];
+        frustum.planes[2] = m[3] + m[1];
+        frustum.planes[3] = m[3] - m[1];
+        frustum.planes[4] = m[3] + m[2];
+        frustum.planes[5] = m[3] - m[2];
+        return frustum;
+    }
+
+    Test test(const AABB& box) const
+    {
+        if (!box.valid())
+            return Test::Outside;
+
+        Test result = Test::Inside;
+        for (const auto& plane : planes) {
+            glm::vec3 n(plane);
+            // the corners furthest along and against the normal
+            glm::vec3 p = glm::mix(box.bmin, box.bmax, glm::greaterThanEqual(n, glm::vec3(0.0f)));
+            glm::vec3 q = glm::mix(box.bmax, box.bmin, glm::greaterThanEqual(n, glm::vec3(0.0f)));
+            if (glm::dot(n, p) + plane.w < 0.0f)
+                return Test::Outside;
+            if (glm::dot(n, q) + plane.w < 0.0f)
+                result = Test::Intersect;
+        }
+        return result;
+    }
+};
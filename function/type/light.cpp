@@ -19,10 +19,9 @@ Lights Lights::fromConfiguration(const std::vector<LightConfiguration>& config)
     lights.buffer = Buffer::New(
         g_ctx.vk,
         config.size() * sizeof(LightData),
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
-    lights.buffer.Update(g_ctx.vk, lights.data.data(), lights.buffer.size);
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    lights.buffer.UpdateDeferred(g_ctx.vk, lights.data.data(), lights.buffer.size);
     g_ctx.dm.registerResource(lights.buffer, DescriptorType::Storage);
     return lights;
 }
@@ -32,7 +31,7 @@ void Lights::update(const LightData* data, int index, int cnt)
     for (int i = index; i < index + cnt; i++) {
         this->data[i] = data[i - index];
     }
-    buffer.Update(g_ctx.vk, this->data.data() + index, cnt * sizeof(LightData), index * sizeof(LightData));
+    buffer.UpdateDeferred(g_ctx.vk, this->data.data() + index, cnt * sizeof(LightData), index * sizeof(LightData));
 }
 
 void Lights::destroy()
@@ -14,7 +14,7 @@ void Material::destroy()
 void Material::update(const MaterialData& data)
 {
     this->data = data;
-    buffer.Update(g_ctx.vk, &this->data, sizeof(data));
+    buffer.UpdateDeferred(g_ctx.vk, &this->data, sizeof(data));
 }
 
 Material Material::fromConfiguration(const MaterialConfiguration& config)
@@ -39,10 +39,9 @@ Material Material::fromConfiguration(const MaterialConfiguration& config)
     material.buffer = Buffer::New(
         g_ctx.vk,
         sizeof(material.data),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
-    material.buffer.Update(g_ctx.vk, &material.data, sizeof(material.data));
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    material.buffer.UpdateDeferred(g_ctx.vk, &material.data, sizeof(material.data));
     g_ctx.dm.registerResource(material.buffer, DescriptorType::Uniform);
 
     return material;
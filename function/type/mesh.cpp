@@ -3,8 +3,12 @@
 #include "core/tool/logger.h"
 #include "function/global_context.h"
 #include "function/tool/geometry.h"
+#include "function/tool/mesh_cache.h"
+#include "function/tool/mesh_optimizer.h"
+#include "function/tool/mesh_simplifier.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
+#include <algorithm>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
@@ -29,11 +33,26 @@ struct IndexEqual {
     }
 };
 
-Mesh Mesh::fromConfiguration(MeshConfiguration& config)
+Mesh Mesh::fromConfiguration(MeshConfiguration& config, MeshCache* cache)
 {
     Mesh mesh;
 
     std::string type = config.at("type").get<std::string>();
+    bool lods        = config["lods"] == nullptr || config["lods"].get<bool>();
+    bool optimize    = config["optimize"] == nullptr ? type == "file" : config["optimize"].get<bool>();
+
+    MeshCache::Key key;
+    bool cached = type == "file" && cache != nullptr && cache->enabled();
+    if (cached) {
+        key.source       = config.at("path").get<std::string>();
+        key.import_flags = importFlags(config);
+        key.options      = (lods ? 1 : 0) | (optimize ? 2 : 0);
+        if (cache->load(key, mesh)) {
+            mesh.name = config.at("name").get<std::string>();
+            return mesh;
+        }
+    }
+
     if (type == "sphere") {
         mesh = sphereMesh(config);
     } else if (type == "cube") {
@@ -47,40 +66,28 @@ Mesh Mesh::fromConfiguration(MeshConfiguration& config)
     }
 
     mesh.name = config.at("name").get<std::string>();
+    mesh.calculateBounds();
+    if (lods) {
+        mesh.generateLods();
+    }
+    if (optimize) {
+        mesh.optimize();
+    }
+    if (cached) {
+        cache->store(key, mesh);
+    }
 
     return mesh;
 }
 
-void Mesh::initBuffersFromData()
-{
-    vertexBuffer = Buffer::New(
-        g_ctx.vk,
-        sizeof(Vertex) * data.vertices.size(),
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    vertexBuffer.Update(g_ctx.vk, data.vertices.data(), vertexBuffer.size);
-
-    indexBuffer = Buffer::New(
-        g_ctx.vk,
-        sizeof(uint32_t) * data.indices.size(),
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    indexBuffer.Update(g_ctx.vk, data.indices.data(), indexBuffer.size);
-}
-
 Mesh Mesh::fileMesh(MeshConfiguration& config)
 {
     Mesh mesh;
 
     std::string inputfile = config.at("path").get<std::string>();
 
-    auto flags = aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenNormals;
-    if (config["flip_uv"] == nullptr || config["flip_uv"].get<bool>()) {
-        flags |= aiProcess_FlipUVs;
-    }
-
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(inputfile, flags);
+    const aiScene* scene = importer.ReadFile(inputfile, importFlags(config));
     if (!scene) {
         ERROR_ALL("Assimp: " + std::string(importer.GetErrorString()));
         throw std::runtime_error("Assimp: " + std::string(importer.GetErrorString()));
@@ -109,11 +116,18 @@ Mesh Mesh::fileMesh(MeshConfiguration& config)
             mesh.data.indices[i * 3 + j] = ai_mesh->mFaces[i].mIndices[j];
     }
 
-    mesh.initBuffersFromData();
-
     return mesh;
 }
 
+uint32_t Mesh::importFlags(MeshConfiguration& config)
+{
+    uint32_t flags = aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenNormals;
+    if (config["flip_uv"] == nullptr || config["flip_uv"].get<bool>()) {
+        flags |= aiProcess_FlipUVs;
+    }
+    return flags;
+}
+
 Mesh Mesh::sphereMesh(MeshConfiguration& config)
 {
     Mesh mesh;
@@ -126,8 +140,6 @@ Mesh Mesh::sphereMesh(MeshConfiguration& config)
     mesh.data.indices        = std::move(indices);
     // mesh.calculateTangents();
 
-    mesh.initBuffersFromData();
-
     return mesh;
 }
 
@@ -142,8 +154,6 @@ Mesh Mesh::cubeMesh(MeshConfiguration& config)
     mesh.data.indices        = std::move(indices);
     mesh.calculateTangents();
 
-    mesh.initBuffersFromData();
-
     return mesh;
 }
 
@@ -159,8 +169,6 @@ Mesh Mesh::planeMesh(MeshConfiguration& config)
     mesh.data.indices        = std::move(indices);
     mesh.calculateTangents();
 
-    mesh.initBuffersFromData();
-
     return mesh;
 }
 
@@ -215,8 +223,6 @@ Mesh Mesh::objMesh(MeshConfiguration& config)
     }
     mesh.calculateTangents();
 
-    mesh.initBuffersFromData();
-
     return mesh;
 }
 
@@ -282,8 +288,89 @@ void Mesh::calculateTangents()
     }
 }
 
-void Mesh::destroy()
+void Mesh::calculateBounds()
+{
+    bounds = AABB::empty();
+    for (const auto& vertex : data.vertices)
+        bounds.expand(vertex.pos);
+}
+
+void Mesh::generateLods()
+{
+    // fewer triangles cost less than the extra draw commands
+    static constexpr size_t MIN_LOD_INDICES = 3 * 512;
+    // past a tenth of the size, a level isn't much of the mesh any more
+    const float max_error = 0.1f * glm::length(bounds.bmax - bounds.bmin);
+
+    lods.clear();
+    float error = 0.0f;
+    while (lodCount() < MAX_LODS) {
+        const auto& source = lods.empty() ? data.indices : lods.back().indices;
+        if (source.size() < MIN_LOD_INDICES || error >= max_error)
+            break;
+        auto result = MeshSimplifier::simplify(data.vertices, source, source.size() / 2, max_error - error);
+        if (result.indices.size() > source.size() * 3 / 4)
+            break;
+        // each level is simplified from the one before
+        error += result.error;
+        lods.push_back(MeshLod { std::move(result.indices), error });
+    }
+
+    if (lods.empty())
+        return;
+    std::string triangles = std::to_string(data.indices.size() / 3);
+    for (const auto& lod : lods)
+        triangles += " > " + std::to_string(lod.indices.size() / 3);
+    INFO_ALL("mesh " + name + ": " + triangles + " triangles in " + std::to_string(lodCount()) + " lods");
+}
+
+void Mesh::optimize()
+{
+    if (data.indices.empty())
+        return;
+    auto before = MeshOptimizer::analyze(data.indices, data.vertices.size());
+
+    MeshOptimizer::optimizeVertexCache(data.indices, data.vertices.size());
+    MeshOptimizer::optimizeOverdraw(data.indices, data.vertices);
+    for (auto& lod : lods) {
+        MeshOptimizer::optimizeVertexCache(lod.indices, data.vertices.size());
+        MeshOptimizer::optimizeOverdraw(lod.indices, data.vertices);
+    }
+
+    // the levels may use a vertex the full mesh doesn't, one identical to another
+    std::vector<uint32_t> all = data.indices;
+    for (const auto& lod : lods)
+        all.insert(all.end(), lod.indices.begin(), lod.indices.end());
+    auto remap = MeshOptimizer::vertexFetchRemap(all, data.vertices.size());
+
+    std::vector<Vertex> vertices(data.vertices.size() - std::count(remap.begin(), remap.end(), UINT32_MAX));
+    for (size_t i = 0; i < remap.size(); i++) {
+        if (remap[i] != UINT32_MAX)
+            vertices[remap[i]] = data.vertices[i];
+    }
+    data.vertices = std::move(vertices);
+    for (auto& index : data.indices)
+        index = remap[index];
+    for (auto& lod : lods) {
+        for (auto& index : lod.indices)
+            index = remap[index];
+    }
+
+    auto after = MeshOptimizer::analyze(data.indices, data.vertices.size());
+    INFO_ALL("mesh " + name + ": ACMR " + std::to_string(before.acmr) + " > " + std::to_string(after.acmr)
+             + ", ATVR " + std::to_string(before.atvr) + " > " + std::to_string(after.atvr));
+}
+
+std::span<const Vertex> Mesh::vertices() const
+{
+    if (mapping)
+        return mapped_vertices;
+    return data.vertices;
+}
+
+std::span<const uint32_t> Mesh::indices(uint32_t lod) const
 {
-    Buffer::Delete(g_ctx.vk, vertexBuffer);
-    Buffer::Delete(g_ctx.vk, indexBuffer);
+    if (mapping)
+        return mapped_indices[lod];
+    return lod == 0 ? data.indices : lods[lod - 1].indices;
 }
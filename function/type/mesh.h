@@ -1,25 +1,59 @@
 #pragma once
 
+#include "aabb.h"
 #include "core/config/config.h"
-#include "core/vulkan/type/buffer.h"
 #include "vertex.h"
+#include <memory>
+#include <span>
 #include <vector>
 
+class MeshCache;
+
 struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
 };
 
+// a simplified version of MeshData::indices, it indexes the same vertices
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    // how far the surface may be from the full mesh, in the local space
+    float error         = 0.0f;
+    uint32_t firstIndex = 0;
+};
+
 struct Mesh {
+    // the full mesh included
+    static constexpr uint32_t MAX_LODS = 4;
+
     std::string name;
 
     MeshData data;
-    Vk::Buffer vertexBuffer;
-    Vk::Buffer indexBuffer;
+    // where the mesh is in the vertex and index buffers of SceneDraws
+    int32_t vertexOffset = 0;
+    uint32_t firstIndex  = 0;
+    // of the vertices in the local space
+    AABB bounds = AABB::empty();
+    // coarser and coarser after the full mesh, generated at load
+    std::vector<MeshLod> lods;
+    // a mesh from MeshCache leaves data and the indices of lods empty and points into the mapped file instead,
+    // which stays mapped while a copy of the mesh lives
+    std::shared_ptr<const void> mapping;
+    std::span<const Vertex> mapped_vertices;
+    std::vector<std::span<const uint32_t>> mapped_indices; // of every level
 
-    static Mesh fromConfiguration(MeshConfiguration& config);
+    // file meshes are looked up in the cache first and stored in it after a miss
+    static Mesh fromConfiguration(MeshConfiguration& config, MeshCache* cache = nullptr);
     void calculateTangents();
-    void destroy();
+    void calculateBounds();
+    // halves the triangles of the last level until MAX_LODS, the error limit or the seams stop it
+    void generateLods();
+    // reorders the triangles of every level and the vertices for the gpu, logs the cache efficiency
+    void optimize();
+    uint32_t lodCount() const { return static_cast<uint32_t>(lods.size()) + 1; }
+    // of data or the mapped file
+    std::span<const Vertex> vertices() const;
+    std::span<const uint32_t> indices(uint32_t lod) const;
 
 private:
     static Mesh sphereMesh(MeshConfiguration& config);
@@ -27,11 +61,11 @@ private:
     static Mesh planeMesh(MeshConfiguration& config);
     static Mesh objMesh(MeshConfiguration& config);
     static Mesh fileMesh(MeshConfiguration& config);
+    static uint32_t importFlags(MeshConfiguration& config);
 
     static glm::vec3 computeTangent(
         const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
         const glm::vec2& uv1, const glm::vec2& uv2, const glm::vec2& uv3);
     // an arbitrary tangent around normal
     static glm::vec3 computeFallbackTangent(const glm::vec3& normal);
-    void initBuffersFromData();
 };
@@ -10,7 +10,7 @@ using namespace Vk;
 
 void Object::destroy()
 {
-    Buffer::Delete(g_ctx.vk, paramBuffer);
+    // param lives in the object buffer of SceneDraws, destroyed by the resource manager
 }
 
 void Object::updateTransform()
@@ -25,7 +25,7 @@ void Object::updateTransform()
     param.modelInvTrans = glm::inverse(param.model);
     param.modelInvTrans = glm::transpose(param.modelInvTrans);
 
-    paramBuffer.Update(g_ctx.vk, &param, sizeof(Param));
+    g_ctx.rm->draws.updateObject(*this);
 }
 
 Object Object::fromConfiguration(ObjectConfiguration& config)
@@ -40,14 +40,6 @@ Object Object::fromConfiguration(ObjectConfiguration& config)
     obj.scale     = arrayToVec3(config.scale);
 
     obj.param.material = g_ctx.dm.getResourceHandle(g_ctx.rm->materials[config.material].buffer.id);
-    obj.paramBuffer    = Buffer::New(
-        g_ctx.vk,
-        sizeof(Param),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        true);
-    // obj.paramBuffer.Update(g_ctx.vk, &obj.param, sizeof(Param)); // it is update in updateTransform
-    g_ctx.dm.registerParameter(obj.paramBuffer);
 
     obj.updateTransform();
 
@@ -60,7 +52,7 @@ HANDLE Object::getVkVertexMemHandle()
     HANDLE handle;
     VkMemoryGetWin32HandleInfoKHR vkMemoryGetWin32HandleInfoKHR = {};
     vkMemoryGetWin32HandleInfoKHR.sType                         = VK_STRUCTURE_TYPE_MEMORY_GET_WIN32_HANDLE_INFO_KHR;
-    vkMemoryGetWin32HandleInfoKHR.memory                        = g_ctx.rm->meshes[mesh].vertexBuffer.memory;
+    vkMemoryGetWin32HandleInfoKHR.memory                        = g_ctx.rm->draws.vertexBuffer.allocation.memory;
     vkMemoryGetWin32HandleInfoKHR.handleType                    = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT;
 
     fpGetMemoryWin32Handle(g_ctx.vk.device, &vkMemoryGetWin32HandleInfoKHR, &handle);
@@ -72,7 +64,7 @@ int Object::getVkVertexMemHandle()
     int fd;
     VkMemoryGetFdInfoKHR vkMemoryGetFdInfoKHR = {};
     vkMemoryGetFdInfoKHR.sType                = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
-    vkMemoryGetFdInfoKHR.memory               = g_ctx.rm->meshes[mesh].vertexBuffer.memory;
+    vkMemoryGetFdInfoKHR.memory               = g_ctx.rm->draws.vertexBuffer.allocation.memory;
     vkMemoryGetFdInfoKHR.handleType           = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
 
     fpGetMemoryFdKHR(g_ctx.vk.device, &vkMemoryGetFdInfoKHR, &fd);
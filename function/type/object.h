@@ -2,7 +2,6 @@
 
 #include "core/config/config.h"
 #include "core/vulkan/descriptor_manager.h"
-#include "core/vulkan/type/buffer.h"
 #include "function/resource_manager/resource.h"
 #include "glm/glm.hpp"
 
@@ -27,7 +26,7 @@ struct Object : public Resource {
     glm::vec3 scale;
 
     Param param;
-    Vk::Buffer paramBuffer;
+    uint32_t index = 0; // in ResourceManager::objects and the object buffer of SceneDraws
 
 #ifdef _WIN64
     HANDLE getVkVertexMemHandle();
@@ -114,11 +114,11 @@ Vk::Image Texture::loadExternalImage(const std::string& path)
         1,
         false,
         tiling);
-    image.Update(g_ctx.vk, ptr);
+    // the resource manager waits for it after loading everything
+    image.UpdateAsync(g_ctx.vk, ptr, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     image.AddSampler(g_ctx.vk,
                      VK_FILTER_LINEAR,
                      std::vector<VkSamplerAddressMode>(3, VK_SAMPLER_ADDRESS_MODE_REPEAT));
-    image.TransitionLayoutSingleTime(g_ctx.vk, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     return image;
 }
@@ -219,6 +219,25 @@ void ImGuiEngine::defaultLightUI()
     ImGui::End();
 }
 
+void ImGuiEngine::defaultStatsUI()
+{
+    ImGui::Begin("Stats");
+    ImGui::Checkbox("Frustum Culling", &g_ctx.rm->draws.culling);
+    ImGui::DragFloat("LOD Error (pixels)", &g_ctx.rm->draws.lod_error, 0.1f, 0.0f, 100.0f);
+    auto stats = g_ctx.rm->draws.stats();
+    ImGui::Text("objects: %u", stats.objects);
+    ImGui::Text("visible objects: %u", stats.visible);
+    if (g_ctx.rm->draws.occlusion) {
+        ImGui::Text("occluded objects: %u", stats.visible - stats.drawn);
+        ImGui::Text("drawn objects: %u", stats.drawn);
+    }
+    ImGui::Text("simplified objects: %u", stats.simplified);
+    ImGui::Text("triangles: %llu", static_cast<unsigned long long>(stats.triangles));
+    ImGui::Text("instanced draws: %u", stats.draws);
+    ImGui::Text("draw calls per object pass: %u", stats.calls);
+    ImGui::End();
+}
+
 void ImGuiEngine::drawAxis()
 {
     static constexpr glm::vec3 origin(0, 0, 0);
@@ -274,6 +293,7 @@ std::function<void(VkCommandBuffer)> ImGuiEngine::getDrawUIFunction()
         defaultCameraUI();
         defaultLightUI();
         defaultRecorderUI();
+        defaultStatsUI();
         drawAxis();
 
         ImGui::Render();
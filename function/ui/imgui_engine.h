@@ -23,6 +23,7 @@ public:
     void defaultMaterialUI();
     void defaultCameraUI();
     void defaultLightUI();
+    void defaultStatsUI();
 
     virtual void init(const Configuration& config, void* render_to_ui) override;
     virtual void cleanup() override;
@@ -7,8 +7,13 @@ function shader_target(name)
             debugsource = is_mode("debug")
         })
     add_packages("glslc")
-    add_files("**/node/" .. name .. "/*.vert")
-    add_files("**/node/" .. name .. "/*.frag")
+    -- compute nodes have no vertex and fragment shaders
+    for _, stage in ipairs({ "vert", "frag", "comp" }) do
+        local pattern = "**/node/" .. name .. "/*." .. stage
+        if #os.files(path.join(os.scriptdir(), pattern)) > 0 then
+            add_files(pattern)
+        end
+    end
     after_build(function(target)
         if not is_mode("release") then
             return
@@ -1,7 +1,8 @@
 add_rules("mode.release", "mode.debug")
 
 add_requires("vulkansdk", "glfw 3.4", "glm 1.0.1")
-add_requires("glslang 1.3", { configs = { binaryonly = true } })
+add_requires("glslang 1.3")
+add_requires("spirv-tools 1.3")
 add_requires("imgui 1.91.1",  {configs = {glfw_vulkan = true}})
 add_requires("cuda", {system=true, configs={utils={"cublas","cusparse","cusolver"}}})
 add_requires("spdlog 1.14.1")
@@ -42,6 +43,7 @@ target("engine")
     add_packages("vulkansdk", "glfw", "glm")
     add_packages("cuda",{public=true})
     add_packages("glslc")
+    add_packages("glslang", "spirv-tools")
     add_packages("spdlog", {public=true})
     add_packages("ffmpeg")
     add_packages("boost", {public=true})
@@ -74,3 +76,5 @@ shader_target("fire_field")
 shader_target("hdr_to_sdr")
 shader_target("calculate_luminance")
 shader_target("fxaa")
+shader_target("occlusion_cull")
+shader_target("depth_pyramid")